@@ -11,6 +11,12 @@ import filecmp
 class Version_pos(enum.Enum):
     ZCURVE_MAGIC = 0
     ZCURVE = 1
+    ZCURVE_LOOKUP_16BIT = 2
+    ZCURVE_LOOKUP_8BIT = 3
+    ZCURVE_LOOKUP_4BIT = 4
+    ZCURVE_SHUFFLE = 5
+    ZCURVE_LOOKUP_16BIT_BATCH = 6
+    ZCURVE_SIMD_LOOKUP_16BIT_BATCH = 7
 
 class Version_at(enum.Enum):
     ZCURVE_MAGIC = 0
@@ -18,12 +24,34 @@ class Version_at(enum.Enum):
     ZCURVE_LOOKUP_8BIT = 2
     ZCURVE_LOOKUP_4BIT = 3
     ZCURVE = 4
+    ZCURVE_SHUFFLE = 5
+    ZCURVE_LOOKUP_RUNTIME = 6
 
 class Version_multi(enum.Enum):
     ZCURVE_MAGIC_SIMD = 0
     ZCURVE_LOOKUP_SIMD_16BIT = 1
     ZCURVE_SIMD = 3
     ZCURVE_MULTITHREADED = 7
+    ZCURVE_LOOKUP_SEQUENTIAL = 9
+    ZCURVE_LOOKUP_SIMD_SEQUENTIAL = 10
+    ZCURVE_SHUFFLE = 11
+    ZCURVE_LOOKUP_RUNTIME = 12
+
+class Version_batch(enum.Enum):
+    ZCURVE_MAGIC = 0
+    ZCURVE_MULTITHREADED = 1
+    ZCURVE_SHUFFLE = 2
+    ZCURVE_LOOKUP_GATHER_8BIT = 3
+    ZCURVE_LOOKUP_GATHER_16BIT = 4
+    ZCURVE_LOOKUP_SEQUENTIAL = 5
+    ZCURVE_MAGIC_8BIT = 6
+    ZCURVE_MAGIC_SIMD_8BIT = 7
+
+class Version_pipelined(enum.Enum):
+    ZCURVE_MAGIC_SIMD = 0
+    ZCURVE_MAGIC = 2
+    ZCURVE_MULTITHREADED = 7
+    ZCURVE = 8
 
 OPTION = ""
 DEGREE = 3
@@ -33,6 +61,8 @@ TESTS = 1
 ZCURVE_PROGRAM = "zcurve"
 VERSION_POS = 0
 VERSION_AT = 0
+# not a multiple of any vector width or thread chunk, so every tail is decoded
+BATCH_POINTS = 100003
 
 
 def print_help():
@@ -45,6 +75,12 @@ def print_help():
 
     -m \t Test if the multithreaded and simd versions produce the same result
 
+    -c \t Test that a corrupted cache entry is regenerated instead of loaded
+
+    -e \t Test if extending from every smaller degree produces the same result as generating directly
+
+    -b \t Test if all batch decoders produce the same points for random indices
+
     -d \t Grad (Default: {DEGREE})
     -t \t Anzahl an Tests (Default: {TESTS})
     -h \t printing help message
@@ -176,10 +212,158 @@ def test_multi():
             print(f"Error: {Version_multi.ZCURVE_MAGIC_SIMD.name} and {j.name} are not the same")
             exit(1)
 
+    for i in Version_pipelined:
+        print("Generating pipelined SVG for " + i.name)
+        subprocess.call([f"./zcurve", f"-V{i.value}", f"-d{DEGREE}", "-P", f"-s", f"{i.name}_PIPELINED.svg"], stdout=open(os.devnull, "w"), stderr=subprocess.STDOUT)
+        if filecmp.cmp(f"{Version_multi.ZCURVE_MAGIC_SIMD.name}.svg", f"{i.name}_PIPELINED.svg") == False:
+            print(f"Error: {Version_multi.ZCURVE_MAGIC_SIMD.name} and pipelined {i.name} are not the same")
+            exit(1)
+        os.remove(f"{i.name}_PIPELINED.svg")
+
+    # the curve file has the same coordinate width whichever kernel or mode wrote it
+    for name, args in [("MAGIC", ["-V0"]), ("SIMD", [f"-V{Version_multi.ZCURVE_SIMD.value}"]), ("PIPELINED", ["-V0", "-P"])]:
+        subprocess.call([f"./zcurve", *args, f"-d{DEGREE}", f"-o", f"{name}.zcv"], stdout=open(os.devnull, "w"), stderr=subprocess.STDOUT)
+        if filecmp.cmp("MAGIC.zcv", f"{name}.zcv", shallow=False) == False:
+            print(f"Error: the curve files of MAGIC and {name} are not the same")
+            exit(1)
+    for name in ["MAGIC", "SIMD", "PIPELINED"]:
+        os.remove(f"{name}.zcv")
+
+    # the compressed file is written, mapped back with its checksum checked and decoded against the curve
+    print("Round trip through the compressed file")
+    result = subprocess.run([f"./zcurve", "-V0", f"-d{DEGREE}", "-zPACKED.zcp", "-B", "1"], stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    if result.returncode != 0 or b"matching checksum" not in result.stdout:
+        print("Error: the compressed file does not decode to the curve")
+        exit(1)
+    os.remove("PACKED.zcp")
+
+    print("Generating SVG in the background")
+    if subprocess.call([f"./zcurve", f"-V{Version_multi.ZCURVE_MULTITHREADED.value}", f"-d{DEGREE}", "-A", f"-s", "ASYNC.svg"], stdout=open(os.devnull, "w"), stderr=subprocess.STDOUT) != 0:
+        print("Error: background generation failed")
+        exit(1)
+    if filecmp.cmp(f"{Version_multi.ZCURVE_MAGIC_SIMD.name}.svg", "ASYNC.svg") == False:
+        print(f"Error: {Version_multi.ZCURVE_MAGIC_SIMD.name} and the background generation are not the same")
+        exit(1)
+    os.remove("ASYNC.svg")
+
+    # the rest of the curve is cancelled once the prefix is saved, the prefix must still be exact
+    with open(f"{Version_multi.ZCURVE_MAGIC_SIMD.name}.svg") as f:
+        reference = regex.findall(r"[ML](\d+),(\d+)", f.read())
+    for points in [1, len(reference) // 3 + 1, len(reference) - 1]:
+        print(f"Generating the first {points} points in the background")
+        if subprocess.call([f"./zcurve", f"-V{Version_multi.ZCURVE_MULTITHREADED.value}", f"-d{DEGREE}", f"-A{points}", f"-s", "ASYNC_PREFIX.svg"], stdout=open(os.devnull, "w"), stderr=subprocess.STDOUT) != 0:
+            print("Error: cancelled background generation failed")
+            exit(1)
+        with open("ASYNC_PREFIX.svg") as f:
+            if regex.findall(r"[ML](\d+),(\d+)", f.read()) != reference[:points]:
+                print(f"Error: the first {points} points of the background generation are not the same")
+                exit(1)
+        os.remove("ASYNC_PREFIX.svg")
+
     for i in Version_multi:
         os.remove(f"{i.name}.svg")
     print("All tests passed!")
 
+def test_batch():
+    global DEGREE
+
+    values = []
+    for version in Version_batch:
+        output = subprocess.check_output([f"./zcurve", f"-V{version.value}", f"-d{DEGREE}", "-b", f"{BATCH_POINTS}"])
+        values.append(regex.findall(r"checksum ([0-9a-f]+)", output.decode("utf-8")))
+        print(f"{version.name}: {values[-1]}")
+
+    if values[0] == []:
+        print("Error: No checksum found")
+        exit(1)
+    for o in range(1, len(values)):
+        if values[0] != values[o]:
+            print(f"Error: {Version_batch(0).name} and {list(Version_batch)[o].name} are not the same")
+            exit(1)
+
+    values = []
+    for version in Version_pos:
+        output = subprocess.check_output([f"./zcurve", f"-V{version.value}", f"-d{DEGREE}", "-p", "-b", f"{BATCH_POINTS}"])
+        values.append(regex.findall(r"checksum ([0-9a-f]+)", output.decode("utf-8")))
+        print(f"{version.name}: {values[-1]}")
+
+    if values[0] == []:
+        print("Error: No checksum found")
+        exit(1)
+    for o in range(1, len(values)):
+        if values[0] != values[o]:
+            print(f"Error: {Version_pos(0).name} and {list(Version_pos)[o].name} are not the same")
+            exit(1)
+    print("All tests passed!")
+
+def test_extend():
+    global DEGREE
+
+    if DEGREE < 2:
+        print("Error: Degree must be at least 2 to extend")
+        exit(1)
+
+    subprocess.call([f"./zcurve", f"-V{Version_multi.ZCURVE_MAGIC_SIMD.value}", f"-d{DEGREE}", f"-s", "EXTEND_REFERENCE.svg"], stdout=open(os.devnull, "w"), stderr=subprocess.STDOUT)
+
+    for i in Version_multi:
+        for start in range(1, DEGREE):
+            print(f"Generating SVG for {i.name} extended from degree {start}")
+            subprocess.call([f"./zcurve", f"-V{i.value}", f"-d{DEGREE}", f"-e{start}", f"-s", f"{i.name}_EXTENDED.svg"], stdout=open(os.devnull, "w"), stderr=subprocess.STDOUT)
+            if filecmp.cmp("EXTEND_REFERENCE.svg", f"{i.name}_EXTENDED.svg", shallow=False) == False:
+                print(f"Error: {i.name} extended from degree {start} is not the same as generated directly")
+                exit(1)
+            os.remove(f"{i.name}_EXTENDED.svg")
+
+    os.remove("EXTEND_REFERENCE.svg")
+    print("All tests passed!")
+
+def test_cache():
+    global DEGREE
+
+    cache_dir = "zcurve_test_cache"
+    if os.path.exists(cache_dir):
+        for name in os.listdir(cache_dir):
+            os.remove(os.path.join(cache_dir, name))
+
+    def run(svg):
+        output = subprocess.check_output([f"./zcurve", f"-d{DEGREE}", "-c", cache_dir, "-s", svg], stderr=subprocess.STDOUT)
+        return "Loaded zcurve from cache!" in output.decode("utf-8")
+
+    print("Generating SVG and storing it in the cache")
+    run("CACHE_REFERENCE.svg")
+    entries = [name for name in os.listdir(cache_dir) if name.endswith(".zcv")]
+    if len(entries) != 1:
+        print(f"Error: expected one cache entry, found {entries}")
+        exit(1)
+
+    # flip the first x coordinate, the header stays intact
+    entry = os.path.join(cache_dir, entries[0])
+    with open(entry, "r+b") as f:
+        f.seek(4096)
+        value = f.read(1)
+        f.seek(4096)
+        f.write(bytes([value[0] ^ 0xff]))
+
+    print("Loading the corrupted entry")
+    if run("CACHE_CORRUPTED.svg"):
+        print("Error: the corrupted cache entry was loaded")
+        exit(1)
+    print("Loading the regenerated entry")
+    if not run("CACHE_REGENERATED.svg"):
+        print("Error: the regenerated cache entry was not loaded")
+        exit(1)
+
+    for name in ["CACHE_CORRUPTED", "CACHE_REGENERATED"]:
+        if filecmp.cmp("CACHE_REFERENCE.svg", f"{name}.svg", shallow=False) == False:
+            print(f"Error: CACHE_REFERENCE and {name} are not the same")
+            exit(1)
+        os.remove(f"{name}.svg")
+
+    os.remove("CACHE_REFERENCE.svg")
+    os.remove(entry)
+    os.rmdir(cache_dir)
+    print("All tests passed!")
+
 def recompile():
     global ZCURVE_PROGRAM
     if os.path.exists(ZCURVE_PROGRAM):
@@ -190,7 +374,7 @@ def recompile():
 if __name__ == "__main__":
     get_positional_arguments()
     try:
-        opts, args = getopt.getopt(sys.argv[1:],"spmid:t:h")
+        opts, args = getopt.getopt(sys.argv[1:],"spmcebid:t:h")
     except getopt.GetoptError:
         print_help()
     try:
@@ -202,6 +386,12 @@ if __name__ == "__main__":
                 OPTION = "-i"
             elif OPTION == "" and i[0] == '-m':
                 OPTION = "-m"
+            elif OPTION == "" and i[0] == '-c':
+                OPTION = "-c"
+            elif OPTION == "" and i[0] == '-e':
+                OPTION = "-e"
+            elif OPTION == "" and i[0] == '-b':
+                OPTION = "-b"
             elif i[0] == '-V':
                 version_tmp = int(i[1])
             elif i[0] == '-d':
@@ -226,4 +416,10 @@ if __name__ == "__main__":
     elif OPTION == "-p":
         test_coordinates_to_index()
     elif OPTION == "-m":
-        test_multi()
\ No newline at end of file
+        test_multi()
+    elif OPTION == "-c":
+        test_cache()
+    elif OPTION == "-e":
+        test_extend()
+    elif OPTION == "-b":
+        test_batch()
\ No newline at end of file
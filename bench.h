@@ -0,0 +1,109 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "defs.h"
+#include "zcurve_memory.h"
+
+// fixed seed, so every run benchmarks the same inputs
+#define BENCH_SEED 0x9e3779b97f4a7c15ull
+
+// buffers a single benchmark may hold at once
+#define BENCH_BUFFERS_MAX 8
+
+// xorshift64
+static inline uint64_t bench_random(uint64_t *state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+
+    return *state;
+}
+
+// random indices below max, which must be a power of two
+static inline void bench_random_indices(uint64_t *state, size_t *idx, size_t count, size_t max)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        idx[i] = bench_random(state) & (max - 1);
+    }
+}
+
+// random points with both coordinates below 2^degree
+static inline void bench_random_points(uint64_t *state, coord_t *x, coord_t *y, size_t count, unsigned degree)
+{
+    uint64_t mask = (1ull << degree) - 1;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t value = bench_random(state);
+
+        x[i] = (coord_t)(value & mask);
+        y[i] = (coord_t)((value >> 32) & mask);
+    }
+}
+
+static inline struct timespec bench_now(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now;
+}
+
+static inline double bench_seconds_since(struct timespec start)
+{
+    struct timespec end = bench_now();
+
+    return end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+}
+
+/*
+every buffer of a benchmark comes from z_curve_alloc through one list, so
+a single bench_free releases them on the error paths and at the end.
+After a failed allocation failed is set and later ones return NULL too
+*/
+typedef struct
+{
+    void *ptr[BENCH_BUFFERS_MAX];
+    size_t size[BENCH_BUFFERS_MAX];
+    unsigned count;
+    bool failed;
+} bench_buffers_t;
+
+static inline void *bench_alloc(bench_buffers_t *buffers, size_t size)
+{
+    if (buffers->failed || buffers->count == BENCH_BUFFERS_MAX)
+    {
+        buffers->failed = true;
+        return NULL;
+    }
+
+    void *ptr = z_curve_alloc(size);
+    if (ptr == NULL)
+    {
+        buffers->failed = true;
+        return NULL;
+    }
+
+    buffers->ptr[buffers->count] = ptr;
+    buffers->size[buffers->count++] = size;
+
+    return ptr;
+}
+
+static inline void bench_free(bench_buffers_t *buffers)
+{
+    for (unsigned i = 0; i < buffers->count; ++i)
+    {
+        z_curve_free(buffers->ptr[i], buffers->size[i]);
+    }
+
+    buffers->count = 0;
+}
+
+#endif // _BENCH_H
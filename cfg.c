@@ -3,6 +3,9 @@
 #include <stdlib.h>
 
 #include "cfg.h"
+#include "zcurve_file.h"
+#include "zcurve_packed.h"
+#include "zcurve_cache.h"
 #include "util.h"
 
 void config_init(config_t *cfg)
@@ -15,6 +18,28 @@ void config_init(config_t *cfg)
     cfg->benchmark_iterations = BENCHMARK_ITERATIONS_DEFAULT;
     cfg->save_svg = SVG_DEFAULT;
     cfg->svg_filename = SVG_FILENAME_DEFAULT;
+    cfg->save_raster = RASTER_DEFAULT;
+    cfg->raster_filename = RASTER_FILENAME_DEFAULT;
+    cfg->save_curve = CURVE_FILE_DEFAULT;
+    cfg->narrow_curve = CURVE_FILE_NARROW_DEFAULT;
+    cfg->curve_filename = CURVE_FILE_FILENAME_DEFAULT;
+    cfg->save_packed = PACKED_FILE_DEFAULT;
+    cfg->packed_filename = PACKED_FILE_FILENAME_DEFAULT;
+    cfg->cache_dir = getenv(CACHE_DIR_ENV);
+
+    if (cfg->cache_dir != NULL && cfg->cache_dir[0] == '\0')
+    {
+        cfg->cache_dir = NULL;
+    }
+    cfg->pipelined = PIPELINE_DEFAULT;
+    cfg->async = ASYNC_DEFAULT;
+    cfg->async_points = 0;
+    cfg->extend_from = EXTEND_DEFAULT;
+    cfg->layout = OUTPUT_LAYOUT_DEFAULT;
+    cfg->pyramid_op = PYRAMID_OP_DEFAULT;
+    cfg->quadtree_capacity = QUADTREE_CAPACITY_DEFAULT;
+    cfg->join_radius = 0;
+    cfg->batch_count = 0;
     cfg->num_threads = THREADS_DEFAULT;
     cfg->path = NULL;
     cfg->index = INDEX_DEFAULT;
@@ -22,6 +47,26 @@ void config_init(config_t *cfg)
     cfg->y = Y_DEFAULT;
 }
 
+static int check_filename(const char *program_name, int c, const char *filename)
+{
+    if (strlen(filename) > SVG_FILENAME_MAX_LENGTH)
+    {
+        fprintf(stderr, "%s: argument for option -- '%c' is invalid: filename is too large\n", program_name, c);
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < strlen(filename); i++)
+    {
+        if (filename[i] == '/')
+        {
+            fprintf(stderr, "%s: argument for option -- '%c' is invalid: '%s' (char %zu)\n", program_name, c, filename, i + 1);
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int config_parse(int argc, char **argv, config_t *cfg)
 {
     static struct option long_options[] = {
@@ -31,6 +76,23 @@ int config_parse(int argc, char **argv, config_t *cfg)
         {"p", no_argument, 0, 'p'},
         {"i", required_argument, 0, 'i'},
         {"s", optional_argument, 0, 's'},
+        {"r", optional_argument, 0, 'r'},
+        {"o", optional_argument, 0, 'o'},
+        {"n", no_argument, 0, 'n'},
+        {"z", optional_argument, 0, 'z'},
+        {"c", required_argument, 0, 'c'},
+        {"l", required_argument, 0, 'l'},
+        {"T", no_argument, 0, 'T'},
+        {"e", required_argument, 0, 'e'},
+        {"w", no_argument, 0, 'w'},
+        {"g", no_argument, 0, 'g'},
+        {"m", required_argument, 0, 'm'},
+        {"k", no_argument, 0, 'k'},
+        {"q", required_argument, 0, 'q'},
+        {"j", required_argument, 0, 'j'},
+        {"b", required_argument, 0, 'b'},
+        {"P", no_argument, 0, 'P'},
+        {"A", optional_argument, 0, 'A'},
         {"help", no_argument, 0, 'h'},
         {0, 0, 0, 0}};
 
@@ -46,7 +108,7 @@ int config_parse(int argc, char **argv, config_t *cfg)
     }
 
     int c;
-    while ((c = getopt_long(argc, argv, "V::B::d:pi:t:s::h", long_options, 0)) != -1)
+    while ((c = getopt_long(argc, argv, "V::B::d:pi:t:s::r::o::nz::c:l:Te:wgm:kq:j:b:PA::h", long_options, 0)) != -1)
     {
         switch (c)
         {
@@ -112,7 +174,7 @@ int config_parse(int argc, char **argv, config_t *cfg)
             }
             break;
         case 'p':
-            if (cfg->mode != STANDARD)
+            if (cfg->mode != STANDARD && cfg->mode != BATCH)
             {
                 fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -i and -p at the same time\n", program_name, c);
                 return EXIT_FAILURE;
@@ -167,22 +229,236 @@ int config_parse(int argc, char **argv, config_t *cfg)
 
             if (optarg != NULL)
             {
-                if (strlen(optarg) > SVG_FILENAME_MAX_LENGTH)
+                if (check_filename(program_name, c, optarg))
                 {
-                    fprintf(stderr, "%s: argument for option -- '%c' is invalid: filename is too large\n", program_name, c);
                     return EXIT_FAILURE;
                 }
 
-                for (size_t i = 0; i < strlen(optarg); i++)
+                cfg->svg_filename = optarg;
+            }
+            break;
+        case 'r':
+            cfg->save_raster = true;
+
+            if (optarg == NULL && argv[optind] != NULL && argv[optind][0] != '-')
+            {
+                optarg = argv[optind++];
+            }
+
+            if (optarg != NULL)
+            {
+                if (check_filename(program_name, c, optarg))
                 {
-                    if (optarg[i] == '/')
-                    {
-                        fprintf(stderr, "%s: argument for option -- '%c' is invalid: '%s' (char %zu)\n", program_name, c, optarg, i + 1);
-                        return EXIT_FAILURE;
-                    }
+                    return EXIT_FAILURE;
                 }
 
-                cfg->svg_filename = optarg;
+                cfg->raster_filename = optarg;
+            }
+            break;
+        case 'o':
+            cfg->save_curve = true;
+
+            if (optarg == NULL && argv[optind] != NULL && argv[optind][0] != '-')
+            {
+                optarg = argv[optind++];
+            }
+
+            if (optarg != NULL)
+            {
+                if (check_filename(program_name, c, optarg))
+                {
+                    return EXIT_FAILURE;
+                }
+
+                cfg->curve_filename = optarg;
+            }
+            break;
+        case 'z':
+            cfg->save_packed = true;
+
+            if (optarg == NULL && argv[optind] != NULL && argv[optind][0] != '-')
+            {
+                optarg = argv[optind++];
+            }
+
+            if (optarg != NULL)
+            {
+                if (check_filename(program_name, c, optarg))
+                {
+                    return EXIT_FAILURE;
+                }
+
+                cfg->packed_filename = optarg;
+            }
+            break;
+        case 'c':
+            if (strlen(optarg) > CACHE_PATH_MAX_LENGTH - SVG_FILENAME_MAX_LENGTH)
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: path is too long\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            cfg->cache_dir = optarg;
+            break;
+        case 'l':
+        {
+            int layout = 0;
+            while (layout < MAX_OUTPUT && strcmp(optarg, output_layout_to_string((output_layout_t)layout)))
+            {
+                ++layout;
+            }
+
+            if (layout == MAX_OUTPUT)
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: layout must be soa, aos or keys\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            cfg->layout = (output_layout_t)layout;
+            break;
+        }
+        case 'T':
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -T together with -i or -p\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+            cfg->mode = TABLES;
+            break;
+        case 'w':
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -w together with -i, -p or -T\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+            cfg->mode = VIEW;
+            break;
+        case 'g':
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -g together with -i, -p, -T or -w\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+            cfg->mode = GRID;
+            break;
+        case 'm':
+        {
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -m together with -i, -p, -T, -w or -g\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            int op = 0;
+            while (op < PYRAMID_MAX_OP && strcmp(optarg, pyramid_op_to_string((pyramid_op_t)op)))
+            {
+                ++op;
+            }
+
+            if (op == PYRAMID_MAX_OP)
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: reduction must be sum, min, max or mean\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            cfg->mode = PYRAMID;
+            cfg->pyramid_op = (pyramid_op_t)op;
+            break;
+        }
+        case 'k':
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -k together with -i, -p, -T, -w, -g or -m\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+            cfg->mode = SORT;
+            break;
+        case 'q':
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -q together with -i, -p, -T, -w, -g, -m or -k\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            if (!is_number(optarg) || !strtoul(optarg, 0, 10))
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: leaf capacity must be a number larger than 0\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            cfg->mode = QUADTREE;
+            cfg->quadtree_capacity = strtoul(optarg, 0, 10);
+            break;
+        case 'j':
+            if (cfg->mode != STANDARD)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -j together with -i, -p, -T, -w, -g, -m, -k or -q\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            if (!is_number(optarg))
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: radius must be a number\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            cfg->mode = JOIN;
+            cfg->join_radius = strtoul(optarg, 0, 10);
+            break;
+        case 'b':
+            if (cfg->mode != STANDARD && cfg->mode != POSITION)
+            {
+                fprintf(stderr, "%s: option -- '%c' is invalid: cannot use -b together with -i, -T, -w, -g, -m, -k, -q or -j\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            if (!is_number(optarg) || !strtoul(optarg, 0, 10) || strtoul(optarg, 0, 10) > BATCH_POINTS_MAX)
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: count must be a number between 1 and %u\n", program_name, c, BATCH_POINTS_MAX);
+                return EXIT_FAILURE;
+            }
+
+            // with -p the points are encoded instead
+            cfg->mode = cfg->mode == POSITION ? POSITION : BATCH;
+            cfg->batch_count = strtoul(optarg, 0, 10);
+            break;
+        case 'e':
+            if (!is_number(optarg))
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: degree must be a number\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+
+            cfg->extend_from = strtoul(optarg, 0, 10);
+            if (!cfg->extend_from)
+            {
+                fprintf(stderr, "%s: argument for option -- '%c' is invalid: degree must be a number larger than 0\n", program_name, c);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'n':
+            cfg->narrow_curve = true;
+            break;
+        case 'P':
+            cfg->pipelined = true;
+            break;
+        case 'A':
+            cfg->async = true;
+
+            if (optarg == NULL && argv[optind] != NULL && argv[optind][0] != '-')
+            {
+                optarg = argv[optind++];
+            }
+
+            if (optarg != NULL)
+            {
+                if (!is_number(optarg) || !strtoull(optarg, 0, 10))
+                {
+                    fprintf(stderr, "%s: argument for option -- '%c' is invalid: number of points must be a number larger than 0\n", program_name, c);
+                    return EXIT_FAILURE;
+                }
+
+                cfg->async_points = strtoull(optarg, 0, 10);
             }
             break;
         case 'h':
@@ -213,6 +489,168 @@ int config_parse(int argc, char **argv, config_t *cfg)
             fprintf(stderr, "%s: argument for option -- 'd' is invalid: degree must be a number between 1 and %u\n", program_name, DEGREE_MAX);
             return EXIT_FAILURE;
         }
+
+        if (cfg->pipelined && !cfg->save_svg && !cfg->save_curve)
+        {
+            fprintf(stderr, "%s: option -- 'P' is invalid: pipelined mode needs an output, use -s or -o\n", program_name);
+            return EXIT_FAILURE;
+        }
+
+        if (cfg->pipelined && cfg->save_raster)
+        {
+            fprintf(stderr, "%s: option -- 'P' is invalid: the raster image needs the whole curve, cannot use -r\n", program_name);
+            return EXIT_FAILURE;
+        }
+
+        if (cfg->layout != OUTPUT_SOA)
+        {
+            if (cfg->implementation != ZCURVE_MAGIC && cfg->implementation != ZCURVE_MAGIC_SIMD)
+            {
+                fprintf(stderr, "%s: option -- 'l' is invalid: only the magic implementations support layout %s\n", program_name, output_layout_to_string(cfg->layout));
+                return EXIT_FAILURE;
+            }
+
+            if (cfg->pipelined || cfg->save_svg || cfg->save_raster || cfg->save_packed)
+            {
+                fprintf(stderr, "%s: option -- 'l' is invalid: layout %s can only be saved with -o\n", program_name, output_layout_to_string(cfg->layout));
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (cfg->pipelined && cfg->save_packed)
+        {
+            fprintf(stderr, "%s: option -- 'P' is invalid: the compressed file needs the whole curve, cannot use -z\n", program_name);
+            return EXIT_FAILURE;
+        }
+
+        if (cfg->extend_from)
+        {
+            if (cfg->extend_from >= cfg->degree)
+            {
+                fprintf(stderr, "%s: argument for option -- 'e' is invalid: degree must be smaller than %u\n", program_name, cfg->degree);
+                return EXIT_FAILURE;
+            }
+
+            if (cfg->pipelined || cfg->layout != OUTPUT_SOA)
+            {
+                fprintf(stderr, "%s: option -- 'e' is invalid: extending needs the whole curve in separate arrays, cannot use -P or -l\n", program_name);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (cfg->narrow_curve)
+        {
+            if (!cfg->save_curve || cfg->degree > COORD8_DEGREE_MAX)
+            {
+                fprintf(stderr, "%s: option -- 'n' is invalid: 8 bit coordinates need -o and a degree of at most %u\n", program_name, COORD8_DEGREE_MAX);
+                return EXIT_FAILURE;
+            }
+
+            if (cfg->pipelined || cfg->async || cfg->layout != OUTPUT_SOA)
+            {
+                fprintf(stderr, "%s: option -- 'n' is invalid: the 8 bit curve file is written from the whole curve, cannot use -P, -A or -l\n", program_name);
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (cfg->async)
+        {
+            if (cfg->implementation != ZCURVE_MULTITHREADED)
+            {
+                fprintf(stderr, "%s: option -- 'A' is invalid: only the multithreaded implementation runs in the background, use -V %u\n", program_name, ZCURVE_MULTITHREADED);
+                return EXIT_FAILURE;
+            }
+
+            if (cfg->should_benchmark || cfg->pipelined || cfg->extend_from || cfg->layout != OUTPUT_SOA)
+            {
+                fprintf(stderr, "%s: option -- 'A' is invalid: cannot use -B, -P, -e or -l\n", program_name);
+                return EXIT_FAILURE;
+            }
+
+            if (!cfg->save_svg && !cfg->save_curve)
+            {
+                fprintf(stderr, "%s: option -- 'A' is invalid: the finished points are saved while generating, use -s or -o\n", program_name);
+                return EXIT_FAILURE;
+            }
+
+            if (cfg->save_raster || cfg->save_packed)
+            {
+                fprintf(stderr, "%s: option -- 'A' is invalid: the raster image and the compressed file need the whole curve, cannot use -r or -z\n", program_name);
+                return EXIT_FAILURE;
+            }
+
+            if (cfg->async_points)
+            {
+                if (cfg->async_points > 1ull << (cfg->degree * 2))
+                {
+                    fprintf(stderr, "%s: argument for option -- 'A' is invalid: degree %u has only %llu points\n", program_name, cfg->degree, 1ull << (cfg->degree * 2));
+                    return EXIT_FAILURE;
+                }
+
+                if (cfg->save_curve)
+                {
+                    fprintf(stderr, "%s: option -- 'A' is invalid: the curve file needs the whole curve, save a part of it with -s\n", program_name);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+    }
+    else if (cfg->narrow_curve)
+    {
+        fprintf(stderr, "%s: option -- 'n' is invalid: 8 bit coordinates can only be used to save a curve\n", program_name);
+        return EXIT_FAILURE;
+    }
+    else if (cfg->async)
+    {
+        fprintf(stderr, "%s: option -- 'A' is invalid: background generation can only be used to generate a curve\n", program_name);
+        return EXIT_FAILURE;
+    }
+    else if (cfg->pipelined)
+    {
+        fprintf(stderr, "%s: option -- 'P' is invalid: pipelined mode can only be used to generate a curve\n", program_name);
+        return EXIT_FAILURE;
+    }
+    else if (cfg->extend_from)
+    {
+        fprintf(stderr, "%s: option -- 'e' is invalid: extending can only be used to generate a curve\n", program_name);
+        return EXIT_FAILURE;
+    }
+
+    if (cfg->mode == TABLES || cfg->mode == VIEW || cfg->mode == PYRAMID || cfg->mode == SORT || cfg->mode == QUADTREE || cfg->mode == JOIN)
+    {
+        if (!cfg->should_benchmark)
+        {
+            const char option[] = {[TABLES] = 'T', [VIEW] = 'w', [PYRAMID] = 'm', [SORT] = 'k', [QUADTREE] = 'q', [JOIN] = 'j'};
+            fprintf(stderr, "%s: option -- '%c' is invalid: the comparison is a benchmark, use -B\n", program_name, option[cfg->mode]);
+            return EXIT_FAILURE;
+        }
+
+        if (cfg->degree > DEGREE_MAX)
+        {
+            fprintf(stderr, "%s: argument for option -- 'd' is invalid: degree must be a number between 1 and %u\n", program_name, DEGREE_MAX);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (cfg->mode == GRID && cfg->degree > DEGREE_MAX)
+    {
+        fprintf(stderr, "%s: argument for option -- 'd' is invalid: degree must be a number between 1 and %u\n", program_name, DEGREE_MAX);
+        return EXIT_FAILURE;
+    }
+
+    if (cfg->mode == BATCH)
+    {
+        if (cfg->implementation >= BATCH_MAX_IMPL)
+        {
+            fprintf(stderr, "%s: argument for option -- 'b' is invalid: implementation must be a number between 0 and %u\n", program_name, BATCH_MAX_IMPL - 1);
+            return EXIT_FAILURE;
+        }
+
+        if (cfg->degree > DEGREE_MAX)
+        {
+            fprintf(stderr, "%s: argument for option -- 'd' is invalid: degree must be a number between 1 and %u\n", program_name, DEGREE_MAX);
+            return EXIT_FAILURE;
+        }
     }
 
     if (cfg->mode == INDEX)
@@ -231,7 +669,18 @@ int config_parse(int argc, char **argv, config_t *cfg)
             fprintf(stderr, "%s: argument for option -- 'p' is invalid: implementation must be a number between 0 and %u\n", program_name, POSITION_MAX_IMPL - 1);
             return EXIT_FAILURE;
         }
+    }
 
+    if (cfg->mode == POSITION && cfg->batch_count)
+    {
+        if (cfg->degree > DEGREE_MAX)
+        {
+            fprintf(stderr, "%s: argument for option -- 'd' is invalid: degree must be a number between 1 and %u\n", program_name, DEGREE_MAX);
+            return EXIT_FAILURE;
+        }
+    }
+    else if (cfg->mode == POSITION)
+    {
         if (optind + 2 > argc)
         {
             fprintf(stderr, "%s: required positional arguments x and y for option -- 'p' are missing\n", program_name);
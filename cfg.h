@@ -4,21 +4,39 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "defs.h"
+#include "zcurve_pyramid.h"
 
 typedef struct
 {
     const char *path;
     char *svg_filename;
+    char *raster_filename;
+    char *curve_filename;
+    char *packed_filename;
+    const char *cache_dir;
     mode_of_operation_t mode;
     int32_t implementation;
+    output_layout_t layout;
+    pyramid_op_t pyramid_op;
+    size_t quadtree_capacity;
+    unsigned join_radius;
+    size_t batch_count;
     size_t index;
     unsigned degree;
+    unsigned extend_from;
     unsigned num_threads;
     unsigned benchmark_iterations;
     coord_t x;
     coord_t y;
     bool should_benchmark;
     bool save_svg;
+    bool save_raster;
+    bool save_curve;
+    bool narrow_curve;
+    bool save_packed;
+    bool pipelined;
+    bool async;
+    size_t async_points;
 } config_t;
 
 void config_init(config_t *cfg);
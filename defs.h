@@ -2,6 +2,7 @@
 #define _COMMON_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #define MODE_DEFAULT STANDARD
 #define IMPLEMENTATION_DEFAULT 0
@@ -9,6 +10,13 @@
 #define DEGREE_DEFAULT 0
 #define DEGREE_MAX 16
 
+/*
+X-macro over the degrees 1 to DEGREE_MAX: kernels are instantiated once
+per degree so their bit loops unroll with constant shifts and masks, and
+are picked from a table indexed with degree - 1
+*/
+#define FOR_EACH_DEGREE(X) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15) X(16)
+
 #define THREADS_DEFAULT 3
 #define THREADS_MIN 1
 #define THREADS_MAX 8
@@ -17,10 +25,57 @@
 #define BENCHMARK_ITERATIONS_DEFAULT 10
 #define BENCHMARK_ITERATIONS_MAX 1000000
 
+// random indices decoded per pass of the lookup table benchmark
+#define TABLE_BENCHMARK_POINTS (1u << 20)
+
+// batch sizes of the batch decoder benchmark, from L1 to well past the LLC
+#define BATCH_BENCHMARK_POINTS_MIN (1u << 10)
+#define BATCH_BENCHMARK_POINTS_MAX (1u << 22)
+
+// random indices decoded at most by a single -b batch
+#define BATCH_POINTS_MAX (1u << 26)
+
+// span length and number of random points of the curve view benchmark
+#define VIEW_BENCHMARK_SPAN 4096
+#define VIEW_BENCHMARK_POINTS (1u << 20)
+
+// radix digit of the encode-then-sort baseline of the sort benchmark
+#define SORT_BENCHMARK_RADIX_BITS 16
+
+// points, point locations and rectangle counts of the quadtree benchmark
+#define QUADTREE_BENCHMARK_POINTS (1u << 20)
+#define QUADTREE_BENCHMARK_QUERIES (1u << 16)
+#define QUADTREE_CAPACITY_DEFAULT 16
+
+// points in each set of the spatial join benchmark
+#define JOIN_BENCHMARK_POINTS (1u << 20)
+
+// grids up to this degree are printed, larger ones only summarised
+#define GRID_PRINT_DEGREE_MAX 4
+
 #define SVG_DEFAULT false
 #define SVG_FILENAME_MAX_LENGTH 255
 #define SVG_FILENAME_DEFAULT "zcurve.svg"
 
+#define RASTER_DEFAULT false
+#define RASTER_FILENAME_DEFAULT "zcurve.ppm"
+
+#define CURVE_FILE_DEFAULT false
+
+// -o stores coord_t unless 8 bit coordinates are asked for
+#define CURVE_FILE_NARROW_DEFAULT false
+
+#define PACKED_FILE_DEFAULT false
+
+#define PIPELINE_DEFAULT false
+
+#define ASYNC_DEFAULT false
+
+// 0: generate the curve directly instead of extending a smaller one
+#define EXTEND_DEFAULT 0
+
+#define OUTPUT_LAYOUT_DEFAULT OUTPUT_SOA
+
 #define INDEX_DEFAULT 0
 #define INDEX_MAX ((1ull << (sizeof(coord_t) << 4)) - 1)
 
@@ -31,11 +86,33 @@
 
 typedef unsigned short coord_t;
 
+// coordinates of curves up to degree 8 fit into a byte
+typedef unsigned char coord8_t;
+
+#define COORD8_DEGREE_MAX 8
+
+typedef struct
+{
+    coord_t x;
+    coord_t y;
+} point_t;
+
+// (y << 16) | x, on little endian the same bytes as point_t
+typedef uint32_t point_key_t;
+
 typedef enum
 {
     STANDARD,
     INDEX,
     POSITION,
+    TABLES,
+    VIEW,
+    GRID,
+    PYRAMID,
+    SORT,
+    QUADTREE,
+    JOIN,
+    BATCH,
     HELP,
     VERSION_HELP,
     MAX_MODE
@@ -52,13 +129,31 @@ typedef enum
     ZCURVE_LOOKUP_4BIT,
     ZCURVE_MULTITHREADED,
     ZCURVE,
+    ZCURVE_LOOKUP_SEQUENTIAL,
+    ZCURVE_LOOKUP_SIMD_SEQUENTIAL,
+    ZCURVE_SHUFFLE,
+    ZCURVE_LOOKUP_RUNTIME,
     MAX_IMPL
 } standard_impl_t;
 
+typedef enum
+{
+    OUTPUT_SOA,
+    OUTPUT_AOS,
+    OUTPUT_KEYS,
+    MAX_OUTPUT
+} output_layout_t;
+
 typedef enum
 {
     POSITION_ZCURVE_MAGIC,
     POSITION_ZCURVE,
+    POSITION_ZCURVE_LOOKUP_16BIT,
+    POSITION_ZCURVE_LOOKUP_8BIT,
+    POSITION_ZCURVE_LOOKUP_4BIT,
+    POSITION_ZCURVE_SHUFFLE,
+    POSITION_ZCURVE_LOOKUP_16BIT_BATCH,
+    POSITION_ZCURVE_SIMD_LOOKUP_16BIT_BATCH,
     POSITION_MAX_IMPL
 } position_impl_t;
 
@@ -69,9 +164,24 @@ typedef enum
     INDEX_ZCURVE_LOOKUP_8BIT,
     INDEX_ZCURVE_LOOKUP_4BIT,
     INDEX_ZCURVE,
+    INDEX_ZCURVE_SHUFFLE,
+    INDEX_ZCURVE_LOOKUP_RUNTIME,
     INDEX_MAX_IMPL
 } index_impl_t;
 
+typedef enum
+{
+    BATCH_ZCURVE_MAGIC,
+    BATCH_ZCURVE_MULTITHREADED,
+    BATCH_ZCURVE_SHUFFLE,
+    BATCH_ZCURVE_LOOKUP_GATHER_8BIT,
+    BATCH_ZCURVE_LOOKUP_GATHER_16BIT,
+    BATCH_ZCURVE_LOOKUP_SEQUENTIAL,
+    BATCH_ZCURVE_MAGIC_8BIT,
+    BATCH_ZCURVE_MAGIC_SIMD_8BIT,
+    BATCH_MAX_IMPL
+} batch_impl_t;
+
 static inline const char *standard_impl_to_string(standard_impl_t impl)
 {
     switch (impl)
@@ -94,6 +204,14 @@ static inline const char *standard_impl_to_string(standard_impl_t impl)
         return "ZCURVE_MAGIC";
     case ZCURVE_MAGIC_SIMD:
         return "ZCURVE_MAGIC_SIMD";
+    case ZCURVE_LOOKUP_SEQUENTIAL:
+        return "ZCURVE_LOOKUP_SEQUENTIAL";
+    case ZCURVE_LOOKUP_SIMD_SEQUENTIAL:
+        return "ZCURVE_LOOKUP_SIMD_SEQUENTIAL";
+    case ZCURVE_SHUFFLE:
+        return "ZCURVE_SHUFFLE";
+    case ZCURVE_LOOKUP_RUNTIME:
+        return "ZCURVE_LOOKUP_RUNTIME";
     default:
         return "UNKNOWN";
     }
@@ -107,6 +225,18 @@ static inline const char *position_impl_to_string(position_impl_t impl)
         return "ZCURVE";
     case POSITION_ZCURVE_MAGIC:
         return "ZCURVE_MAGIC";
+    case POSITION_ZCURVE_LOOKUP_16BIT:
+        return "ZCURVE_LOOKUP_16BIT";
+    case POSITION_ZCURVE_LOOKUP_8BIT:
+        return "ZCURVE_LOOKUP_8BIT";
+    case POSITION_ZCURVE_LOOKUP_4BIT:
+        return "ZCURVE_LOOKUP_4BIT";
+    case POSITION_ZCURVE_SHUFFLE:
+        return "ZCURVE_SHUFFLE";
+    case POSITION_ZCURVE_LOOKUP_16BIT_BATCH:
+        return "ZCURVE_LOOKUP_16BIT_BATCH";
+    case POSITION_ZCURVE_SIMD_LOOKUP_16BIT_BATCH:
+        return "ZCURVE_SIMD_LOOKUP_16BIT_BATCH";
     default:
         return "UNKNOWN";
     }
@@ -126,6 +256,50 @@ static inline const char *index_impl_to_string(index_impl_t impl)
         return "ZCURVE_LOOKUP_16BIT";
     case INDEX_ZCURVE_MAGIC:
         return "ZCURVE_MAGIC";
+    case INDEX_ZCURVE_SHUFFLE:
+        return "ZCURVE_SHUFFLE";
+    case INDEX_ZCURVE_LOOKUP_RUNTIME:
+        return "ZCURVE_LOOKUP_RUNTIME";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+static inline const char *batch_impl_to_string(batch_impl_t impl)
+{
+    switch (impl)
+    {
+    case BATCH_ZCURVE_MAGIC:
+        return "ZCURVE_MAGIC";
+    case BATCH_ZCURVE_MULTITHREADED:
+        return "ZCURVE_MULTITHREADED";
+    case BATCH_ZCURVE_SHUFFLE:
+        return "ZCURVE_SHUFFLE";
+    case BATCH_ZCURVE_LOOKUP_GATHER_8BIT:
+        return "ZCURVE_LOOKUP_GATHER_8BIT";
+    case BATCH_ZCURVE_LOOKUP_GATHER_16BIT:
+        return "ZCURVE_LOOKUP_GATHER_16BIT";
+    case BATCH_ZCURVE_LOOKUP_SEQUENTIAL:
+        return "ZCURVE_LOOKUP_SEQUENTIAL";
+    case BATCH_ZCURVE_MAGIC_8BIT:
+        return "ZCURVE_MAGIC_8BIT";
+    case BATCH_ZCURVE_MAGIC_SIMD_8BIT:
+        return "ZCURVE_MAGIC_SIMD_8BIT";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+static inline const char *output_layout_to_string(output_layout_t layout)
+{
+    switch (layout)
+    {
+    case OUTPUT_SOA:
+        return "soa";
+    case OUTPUT_AOS:
+        return "aos";
+    case OUTPUT_KEYS:
+        return "keys";
     default:
         return "UNKNOWN";
     }
@@ -141,6 +315,22 @@ static inline const char *mode_to_string(mode_of_operation_t mode)
         return "INDEX";
     case POSITION:
         return "POSITION";
+    case TABLES:
+        return "TABLES";
+    case VIEW:
+        return "VIEW";
+    case GRID:
+        return "GRID";
+    case PYRAMID:
+        return "PYRAMID";
+    case SORT:
+        return "SORT";
+    case QUADTREE:
+        return "QUADTREE";
+    case JOIN:
+        return "JOIN";
+    case BATCH:
+        return "BATCH";
     case HELP:
         return "HELP";
     default:
@@ -158,6 +348,8 @@ static inline const char *impl_to_string(int impl, mode_of_operation_t mode)
         return index_impl_to_string((index_impl_t)impl);
     case POSITION:
         return position_impl_to_string((position_impl_t)impl);
+    case BATCH:
+        return batch_impl_to_string((batch_impl_t)impl);
     default:
         return "UNKNOWN";
     }
@@ -177,6 +177,62 @@ int generate_lookup_table(unsigned short table_size)
     return 0;
 }
 
+int generate_encode_lookup_table(unsigned short table_size)
+{
+    if (!table_size || table_size & 1)
+    {
+        fprintf(stderr, "Error: Table size must be a positive even number larger than 0.\n");
+        return 1;
+    }
+
+    if (table_size > LOOKUP_TABLE_MAX_SIZE)
+    {
+        fprintf(stderr, "Error: Table size is too large. Maximum size is %d.\n", LOOKUP_TABLE_MAX_SIZE);
+        return 1;
+    }
+
+    // a table for indices of table_size bits dilates coordinates of half as many bits
+    unsigned degree = table_size >> 1;
+    size_t size = 1ull << degree;
+
+    printf("Generating encode lookup table for %zu coordinates...\n", size);
+
+    char filename[256];
+    snprintf(filename, sizeof(filename), "lookup_table_encode_%ubit.h", table_size);
+
+    FILE *file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Could not open file '%s' for writing.\n", filename);
+        return 1;
+    }
+
+    // the dilated value of v has the bits of v at the even positions
+    const char *type = table_size > 8 ? "unsigned short" : "unsigned char";
+
+    fprintf(file, "#ifndef _LOOKUP_TABLE_ENCODE_%uBIT_H\n", table_size);
+    fprintf(file, "#define _LOOKUP_TABLE_ENCODE_%uBIT_H\n\n", table_size);
+
+    fprintf(file, "static const %s encode_table_%ubit[%zu] = {\n", type, table_size, size);
+
+    for (size_t i = 0; i < size; i++)
+    {
+        fprintf(file, "    0x%zx", z_curve_pos(degree, (coord_t)i, 0));
+        if (i < size - 1)
+        {
+            fprintf(file, ",");
+        }
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "};\n");
+    fprintf(file, "#endif // _LOOKUP_TABLE_ENCODE_%uBIT_H\n", table_size);
+
+    fclose(file);
+
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     // we get an array of table sizes, e.g. 4, 8, 16, 24
@@ -223,6 +279,12 @@ int main(int argc, char *argv[])
             printf("Error: Could not generate SIMD lookup table for %ubit.\n", tables[i]);
             return 1;
         }
+
+        if (generate_encode_lookup_table(tables[i]) != 0)
+        {
+            printf("Error: Could not generate encode lookup table for %ubit.\n", tables[i]);
+            return 1;
+        }
     }
 
     printf("Done.\n");
@@ -11,12 +11,30 @@
 
 #include "zcurve_simd.h"
 #include "zcurve_lookup.h"
+#include "zcurve_shuffle.h"
+#include "zcurve_tables.h"
+#include "zcurve_extend.h"
+#include "zcurve_view.h"
+#include "zcurve_grid.h"
+#include "zcurve_pyramid.h"
+#include "zcurve_sort.h"
+#include "zcurve_quadtree.h"
+#include "zcurve_join.h"
 #include "zcurve_multithreading.h"
 #include "zcurve_magic.h"
+#include "zcurve_memory.h"
+#include "zcurve_8bit.h"
+#include "zcurve_pipeline.h"
+#include "zcurve_async.h"
+#include "zcurve_file.h"
+#include "zcurve_packed.h"
+#include "zcurve_cache.h"
 #include "zcurve.h"
 #include "svg.h"
+#include "raster.h"
 #include "cfg.h"
 #include "util.h"
+#include "bench.h"
 
 #define USAGE "Usage: %s [options]\n"                                                                 \
               "Options:\n"                                                                            \
@@ -34,13 +52,56 @@
               "                     Please note: This option is mutually exclusive with -p\n"         \
               "  -s <opt:filename>  Save generated z-curve as SVG (defualt: false)\n"                 \
               "                     Optional argument specifies filename (default: zcurve.svg)\n"     \
-              "  -h                 Prints this help text\n"                                          \
-              "  --help             Prints this help text\n"                                          \
-              "Examples:\n"                                                                           \
-              "  %s -d 5 -s         Generates a zcurve of degree 5 and saves it to zcurve.svg\n"      \
-              "  %s -d 5 -B 1 -V 1  Measures the runtime of the SIMD implementation 1 time\n"         \
-              "  %s -d 9 -i 91186   Calculates the coordinates of the point at index 91186\n"         \
-              "  %s -d 9 -p 53 6    Calculates the index of the point at coordinates (53, 6)\n"
+              "  -r <opt:filename>  Save generated z-curve as PPM image (default: false)\n"            \
+              "                     Large degrees are drawn with a coarser level of detail\n"       \
+              "                     Optional argument specifies filename (default: zcurve.ppm)\n"    \
+              "  -o <opt:filename>  Save generated z-curve as memory-mappable binary file\n"          \
+              "                     Optional argument specifies filename (default: zcurve.zcv)\n"    \
+              "  -n                 Store the curve file with 8 bit coordinates, up to degree 8\n"  \
+              "  -z <opt:filename>  Save generated z-curve as compressed binary file\n"                \
+              "                     Optional argument specifies filename (default: zcurve.zcp)\n"    \
+              "                     With -B measures compression ratio and decode speed instead\n"   \
+              "  -l <layout>        Memory layout of the generated curve (default: soa)\n"            \
+              "                     soa: separate x and y arrays, aos: {x, y} pairs,\n"              \
+              "                     keys: (y << 16) | x per point; aos and keys need -V 0 or -V 2\n" \
+              "                     and can only be saved with -o\n"                                  \
+              "  -c <dir>           Look up the curve in this cache directory before generating\n"  \
+              "                     and store it there on a miss (default: $ZCURVE_CACHE_DIR)\n"
+
+// -Wpedantic limits a string literal to 4095 characters, so the help text comes in three parts
+#define USAGE_MODES "  -T                 Compare the static and the runtime-built lookup tables, needs -B\n" \
+                    "                     Measures cold start and random access for indices of degree -d\n" \
+                    "                     and the batch decoders across working-set sizes\n"             \
+                    "  -w                 Compare reading the curve through a lazy view with generating it, needs -B\n" \
+                    "                     Sequential, span and random access for degree -d\n" \
+                    "  -g                 Generate the inverse grid: the curve index of every cell (x, y)\n" \
+                    "                     Uses -t threads, with -B compares the scalar, SIMD and threaded builds\n" \
+                    "  -m <reduction>     Compare a mipmap pyramid over Z order with a row-major one, needs -B\n" \
+                    "                     reduction is sum, min, max or mean, uses -t threads\n" \
+                    "  -k                 Compare the key-free Z order sort with radix sorting keys, needs -B\n" \
+                    "                     Sorts 4^d random 32 bit points, uses -t threads\n" \
+                    "  -q <number>        Build a linear quadtree with this many points per leaf over random\n" \
+                    "                     points of degree -d and measure its queries, needs -B\n" \
+                    "  -j <number>        Join random points on pairs this close or in a cell this wide, needs -B\n" \
+                    "                     Compares one thread with -t threads\n" \
+                    "  -e <number>        Generate the curve at this degree and extend it in place up to -d\n" \
+                    "                     Uses -t threads, with -B compares against generating directly\n" \
+                    "  -b <number>        Decode this many random indices of degree -d with a batch decoder\n" \
+                    "                     Prints a checksum of the points, with -B times the batch\n" \
+                    "                     With -p encodes this many random points of degree -d instead\n" \
+                    "  -P                 Generate and save the curve block by block in a pipeline\n"      \
+                    "                     Uses -t generator threads, only needs memory for a few blocks\n" \
+                    "  -A <opt:number>    Generate the curve in the background with -V 7 and -t threads\n" \
+                    "                     and save the finished points with -s or -o while it runs\n" \
+                    "                     Optional argument saves only this many points, with -s\n" \
+                    "  -h                 Prints this help text\n"                                          \
+                    "  --help             Prints this help text\n"
+
+#define USAGE_EXAMPLES "Examples:\n"                                                                 \
+                       "  %s -d 5 -s         Generates a zcurve of degree 5 and saves it to zcurve.svg\n"      \
+                       "  %s -d 5 -B 1 -V 1  Measures the runtime of the SIMD implementation 1 time\n"         \
+                       "  %s -d 9 -i 91186   Calculates the coordinates of the point at index 91186\n"         \
+                       "  %s -d 9 -p 53 6    Calculates the index of the point at coordinates (53, 6)\n"
 
 static inline int run_index(const config_t *cfg)
 {
@@ -78,6 +139,14 @@ static inline int run_index(const config_t *cfg)
         version = "ZCURVE_MAGIC";
         z_curve_magic_at(cfg->degree, cfg->index, &x, &y);
         break;
+    case INDEX_ZCURVE_SHUFFLE:
+        version = "ZCURVE_SHUFFLE";
+        z_curve_shuffle_at(cfg->degree, cfg->index, &x, &y);
+        break;
+    case INDEX_ZCURVE_LOOKUP_RUNTIME:
+        version = "ZCURVE_LOOKUP_RUNTIME";
+        z_curve_lookup_runtime_at(cfg->degree, cfg->index, &x, &y);
+        break;
     default:
         fprintf(stderr, "%s: invalid implementation %u specified - No SIMD or Multithreaded-Version allowed!\n", get_filename(cfg->path), cfg->implementation);
         return -1;
@@ -97,12 +166,12 @@ static inline int benchmark_index(const config_t *cfg)
         }
     }
 
-    struct timespec start, end;
+    struct timespec start;
     double time_total = 0.0;
     coord_t x = 0, y = 0;
     for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
     {
-        clock_gettime(CLOCK_MONOTONIC, &start);
+        start = bench_now();
         switch (cfg->implementation)
         {
         case INDEX_ZCURVE:
@@ -120,12 +189,17 @@ static inline int benchmark_index(const config_t *cfg)
         case INDEX_ZCURVE_MAGIC:
             z_curve_magic_at(cfg->degree, cfg->index, &x, &y);
             break;
+        case INDEX_ZCURVE_SHUFFLE:
+            z_curve_shuffle_at(cfg->degree, cfg->index, &x, &y);
+            break;
+        case INDEX_ZCURVE_LOOKUP_RUNTIME:
+            z_curve_lookup_runtime_at(cfg->degree, cfg->index, &x, &y);
+            break;
         default:
             fprintf(stderr, "%s: invalid implementation %u specified - No SIMD or Multithreaded-Version allowed!\n", get_filename(cfg->path), cfg->implementation);
             return -1;
         }
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        time_total += (end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec));
+        time_total += bench_seconds_since(start);
         sleep(1);
     }
     printf("Index %zu for degree %u at: (%u, %u)\n", cfg->index, cfg->degree, x, y);
@@ -158,8 +232,32 @@ static inline int run_position(const config_t *cfg)
         version = "ZCURVE_MAGIC";
         index = z_curve_magic_pos(cfg->degree, cfg->x, cfg->y);
         break;
+    case POSITION_ZCURVE_LOOKUP_16BIT:
+        version = "ZCURVE_LOOKUP_16BIT";
+        index = z_curve_lookup_16bit_pos(cfg->degree, cfg->x, cfg->y);
+        break;
+    case POSITION_ZCURVE_LOOKUP_8BIT:
+        version = "ZCURVE_LOOKUP_8BIT";
+        index = z_curve_lookup_8bit_pos(cfg->degree, cfg->x, cfg->y);
+        break;
+    case POSITION_ZCURVE_LOOKUP_4BIT:
+        version = "ZCURVE_LOOKUP_4BIT";
+        index = z_curve_lookup_4bit_pos(cfg->degree, cfg->x, cfg->y);
+        break;
+    case POSITION_ZCURVE_SHUFFLE:
+        version = "ZCURVE_SHUFFLE";
+        index = z_curve_shuffle_pos(cfg->degree, cfg->x, cfg->y);
+        break;
+    case POSITION_ZCURVE_LOOKUP_16BIT_BATCH:
+        version = "ZCURVE_LOOKUP_16BIT_BATCH";
+        z_curve_lookup_16bit_pos_batch(&cfg->x, &cfg->y, 1, &index);
+        break;
+    case POSITION_ZCURVE_SIMD_LOOKUP_16BIT_BATCH:
+        version = "ZCURVE_SIMD_LOOKUP_16BIT_BATCH";
+        z_curve_simd_lookup_16bit_pos_batch(&cfg->x, &cfg->y, 1, &index);
+        break;
     default:
-        fprintf(stderr, "%s: invalid implementation specified - No SIMD, LUT or Multithreaded-Version allowed\n", get_filename(cfg->path));
+        fprintf(stderr, "%s: invalid implementation specified - No SIMD or Multithreaded-Version allowed\n", get_filename(cfg->path));
         return -1;
     }
     printf("%s: Position (%u, %u) for degree %u at index: %zu\n", version, cfg->x, cfg->y, cfg->degree, index);
@@ -177,12 +275,12 @@ static inline int benchmark_position(const config_t *cfg)
         }
     }
 
-    struct timespec start, end;
+    struct timespec start;
     double time_total = 0.0;
     size_t index = 0;
     for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
     {
-        clock_gettime(CLOCK_MONOTONIC, &start);
+        start = bench_now();
         switch (cfg->implementation)
         {
         case POSITION_ZCURVE:
@@ -191,12 +289,29 @@ static inline int benchmark_position(const config_t *cfg)
         case POSITION_ZCURVE_MAGIC:
             index = z_curve_magic_pos(cfg->degree, cfg->x, cfg->y);
             break;
+        case POSITION_ZCURVE_LOOKUP_16BIT:
+            index = z_curve_lookup_16bit_pos(cfg->degree, cfg->x, cfg->y);
+            break;
+        case POSITION_ZCURVE_LOOKUP_8BIT:
+            index = z_curve_lookup_8bit_pos(cfg->degree, cfg->x, cfg->y);
+            break;
+        case POSITION_ZCURVE_LOOKUP_4BIT:
+            index = z_curve_lookup_4bit_pos(cfg->degree, cfg->x, cfg->y);
+            break;
+        case POSITION_ZCURVE_SHUFFLE:
+            index = z_curve_shuffle_pos(cfg->degree, cfg->x, cfg->y);
+            break;
+        case POSITION_ZCURVE_LOOKUP_16BIT_BATCH:
+            z_curve_lookup_16bit_pos_batch(&cfg->x, &cfg->y, 1, &index);
+            break;
+        case POSITION_ZCURVE_SIMD_LOOKUP_16BIT_BATCH:
+            z_curve_simd_lookup_16bit_pos_batch(&cfg->x, &cfg->y, 1, &index);
+            break;
         default:
-            fprintf(stderr, "%s: invalid implementation specified - No SIMD, LUT or Multithreaded-Version allowed\n", get_filename(cfg->path));
+            fprintf(stderr, "%s: invalid implementation specified - No SIMD or Multithreaded-Version allowed\n", get_filename(cfg->path));
             return -1;
         }
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        time_total += (end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec));
+        time_total += bench_seconds_since(start);
         sleep(1);
     }
     printf("Position (%u, %u) for degree %u at index: %zu\n", cfg->x, cfg->y, cfg->degree, index);
@@ -206,218 +321,2157 @@ static inline int benchmark_position(const config_t *cfg)
     return 0;
 }
 
-static inline int run_standard_impl(const config_t *cfg, coord_t *x, coord_t *y)
+static inline void run_table_impl(int table, const size_t *idx, size_t count, coord_t *x, coord_t *y)
 {
-    switch (cfg->implementation)
+    switch (table)
     {
-    case ZCURVE:
-        z_curve(cfg->degree, x, y);
-        break;
-    case ZCURVE_MULTITHREADED:
-        if (z_curve_multithreaded(cfg->degree, x, y, cfg->num_threads))
+    case INDEX_ZCURVE_LOOKUP_4BIT:
+        for (size_t i = 0; i < count; ++i)
         {
-            fprintf(stderr, "%s: failed to run multithreaded implementation\n", get_filename(cfg->path));
-            return -1;
+            z_curve_lookup_4bit_at(DEGREE_MAX, idx[i], &x[i], &y[i]);
         }
         break;
-    case ZCURVE_LOOKUP_4BIT:
-        z_curve_lookup_4bit(cfg->degree, x, y);
-        break;
-    case ZCURVE_LOOKUP_8BIT:
-        z_curve_lookup_8bit(cfg->degree, x, y);
-        break;
-    case ZCURVE_LOOKUP_16BIT:
-        z_curve_lookup_16bit(cfg->degree, x, y);
-        break;
-    case ZCURVE_MAGIC:
-        z_curve_magic(cfg->degree, x, y);
-        break;
-    case ZCURVE_SIMD:
-        z_curve_simd(cfg->degree, x, y);
-        break;
-    case ZCURVE_LOOKUP_SIMD_16BIT:
-        z_curve_simd_lookup_16bit(cfg->degree, x, y);
+    case INDEX_ZCURVE_LOOKUP_8BIT:
+        for (size_t i = 0; i < count; ++i)
+        {
+            z_curve_lookup_8bit_at(DEGREE_MAX, idx[i], &x[i], &y[i]);
+        }
         break;
-    case ZCURVE_MAGIC_SIMD:
-        z_curve_simd_magic(cfg->degree, x, y);
+    case INDEX_ZCURVE_LOOKUP_16BIT:
+        for (size_t i = 0; i < count; ++i)
+        {
+            z_curve_lookup_16bit_at(DEGREE_MAX, idx[i], &x[i], &y[i]);
+        }
         break;
     default:
-        fprintf(stderr, "%s: unknown implementation\n", get_filename(cfg->path));
-        return -1;
+        z_curve_lookup_runtime_batch_at(idx, count, x, y);
+        break;
     }
-
-    return 0;
 }
 
-static inline int benchmark_standard(const config_t *cfg)
+/*
+the first pass over the random indices is the cold start: it faults in
+the static tables or builds the runtime table, the later passes measure
+random access with the table in cache
+*/
+static inline int benchmark_tables(const config_t *cfg)
 {
+    static const int tables[] = {INDEX_ZCURVE_LOOKUP_4BIT, INDEX_ZCURVE_LOOKUP_8BIT, INDEX_ZCURVE_LOOKUP_16BIT, INDEX_ZCURVE_LOOKUP_RUNTIME};
+    const size_t table_sizes[] = {sizeof(lookup_table_4bit), sizeof(lookup_table_8bit), sizeof(lookup_table_16bit), z_curve_runtime_table_size()};
+
     size_t max = 1ull << (cfg->degree * 2);
-    coord_t *x = (coord_t *)malloc(sizeof(coord_t) * max);
-    if (x == NULL)
+    size_t count = TABLE_BENCHMARK_POINTS;
+
+    bench_buffers_t buffers = {0};
+    size_t *idx = (size_t *)bench_alloc(&buffers, sizeof(size_t) * count);
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    if (buffers.failed)
     {
-        fprintf(stderr, "%s: error in benchmark_standard: failed to allocate memory for x\n", get_filename(cfg->path));
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in benchmark_tables: failed to allocate memory\n", get_filename(cfg->path));
         return -1;
     }
 
-    coord_t *y = (coord_t *)malloc(sizeof(coord_t) * max);
-    if (y == NULL)
+    uint64_t state = BENCH_SEED;
+    bench_random_indices(&state, idx, count, max);
+
+    printf("Random access to %zu indices for degree %u, runtime tables use %u bits\n", count, cfg->degree, RUNTIME_TABLE_BITS);
+
+    int result = 0;
+    for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]) && !result; ++t)
     {
-        free(x);
-        fprintf(stderr, "%s: error in benchmark_standard: failed to allocate memory for y\n", get_filename(cfg->path));
+        struct timespec start;
+
+        start = bench_now();
+        run_table_impl(tables[t], idx, count, x, y);
+        double time_cold = bench_seconds_since(start);
+
+        double time_total = 0.0;
+        for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+        {
+            sleep(1);
+
+            start = bench_now();
+            run_table_impl(tables[t], idx, count, x, y);
+            time_total += bench_seconds_since(start);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            coord_t check_x, check_y;
+            z_curve_magic_at(DEGREE_MAX, idx[i], &check_x, &check_y);
+
+            if (x[i] != check_x || y[i] != check_y)
+            {
+                fprintf(stderr, "%s: error in benchmark_tables: %s decoded index %zu wrong\n", get_filename(cfg->path), index_impl_to_string((index_impl_t)tables[t]), idx[i]);
+                result = -1;
+                break;
+            }
+        }
+
+        printf("%s: table %zu bytes, cold start %f seconds, random access %f seconds on average\n",
+               index_impl_to_string((index_impl_t)tables[t]), table_sizes[t], time_cold, time_total / cfg->benchmark_iterations);
+    }
+
+    bench_free(&buffers);
+
+    return result;
+}
+
+/*
+the view against materialising the whole curve: reading every point in
+order, one point at a time and in spans, and random points
+*/
+static inline int benchmark_view(const config_t *cfg)
+{
+    z_curve_view_t view;
+    if (z_curve_view_init(&view, cfg->degree))
+    {
+        fprintf(stderr, "%s: error in benchmark_view: failed to create view\n", get_filename(cfg->path));
         return -1;
     }
 
-    unsigned long n = cfg->benchmark_iterations;
-    struct timespec start, end;
-    double time_total = 0.0;
+    size_t max = view.num_points;
+    coord_t span_x[VIEW_BENCHMARK_SPAN], span_y[VIEW_BENCHMARK_SPAN];
 
-    while (n--)
+    struct timespec start;
+    double time_bulk = 0.0, time_at = 0.0, time_span = 0.0, time_random = 0.0;
+
+    // keeps the reads from being optimised away
+    size_t sum = 0;
+
+    coord_t *x = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    coord_t *y = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
     {
-        clock_gettime(CLOCK_MONOTONIC, &start);
-        if (run_standard_impl(cfg, x, y))
+        if (x != NULL && y != NULL)
         {
-            free(x);
-            free(y);
-            return -1;
+            start = bench_now();
+            z_curve_simd_magic(cfg->degree, x, y);
+            time_bulk += bench_seconds_since(start);
+
+            sleep(1);
+        }
+
+        start = bench_now();
+        for (size_t idx = 0; idx < max; ++idx)
+        {
+            coord_t px = 0, py = 0;
+            z_curve_view_at(&view, idx, &px, &py);
+            sum += px ^ py;
+        }
+        time_at += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        for (size_t idx = 0; idx < max; idx += VIEW_BENCHMARK_SPAN)
+        {
+            size_t count = z_curve_view_span(&view, idx, VIEW_BENCHMARK_SPAN, span_x, span_y);
+            sum += span_x[count - 1] ^ span_y[count - 1];
+        }
+        time_span += bench_seconds_since(start);
+
+        sleep(1);
+
+        // the counters cover one random pass, not the sequential reads before it
+        view.hits = 0;
+        view.misses = 0;
+
+        uint64_t state = BENCH_SEED;
+        start = bench_now();
+        for (size_t n = 0; n < VIEW_BENCHMARK_POINTS; ++n)
+        {
+            coord_t px = 0, py = 0;
+            z_curve_view_at(&view, bench_random(&state) & (max - 1), &px, &py);
+            sum += px ^ py;
         }
-        clock_gettime(CLOCK_MONOTONIC, &end);
-        time_total += (end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec));
+        time_random += bench_seconds_since(start);
+
         sleep(1);
     }
 
-    if (cfg->benchmark_iterations == 1)
+    unsigned n = cfg->benchmark_iterations;
+    printf("View of degree %u uses %zu bytes instead of %zu (checksum %zu)\n", cfg->degree, z_curve_view_size(&view), sizeof(coord_t) * 2 * max, sum);
+
+    if (x != NULL && y != NULL)
     {
-        printf("One repetition takes %lf seconds\n", time_total);
+        printf("Generating the whole curve took %lf seconds on average\n", time_bulk / n);
     }
     else
     {
-        printf("%u repetitions took %lf seconds on average\n", cfg->benchmark_iterations, time_total / cfg->benchmark_iterations);
+        printf("Generating the whole curve skipped, not enough memory\n");
     }
 
-    free(x);
-    free(y);
+    printf("Reading every point through the view took %lf seconds on average\n", time_at / n);
+    printf("Reading spans of %u points through the view took %lf seconds on average\n", VIEW_BENCHMARK_SPAN, time_span / n);
+    printf("Reading %u random points through the view took %lf seconds on average (%zu chunk hits, %zu misses per pass)\n",
+           VIEW_BENCHMARK_POINTS, time_random / n, view.hits, view.misses);
+
+    z_curve_free(x, sizeof(coord_t) * max);
+    z_curve_free(y, sizeof(coord_t) * max);
+    z_curve_view_destroy(&view);
 
     return 0;
 }
 
-static inline int run_standard(const config_t *cfg)
+static inline int run_grid(const config_t *cfg)
 {
-    size_t max = 1ull << (cfg->degree * 2);
-    coord_t *x = (coord_t *)malloc(sizeof(coord_t) * max);
-    if (x == NULL)
+    size_t width = 1ull << cfg->degree;
+    size_t bytes = sizeof(uint32_t) * width * width;
+
+    uint32_t *grid = (uint32_t *)z_curve_alloc(bytes);
+    if (grid == NULL)
     {
-        fprintf(stderr, "%s: error in run_standard: failed to allocate memory for x\n", get_filename(cfg->path));
+        fprintf(stderr, "%s: error in run_grid: failed to allocate memory for the grid\n", get_filename(cfg->path));
         return -1;
     }
 
-    coord_t *y = (coord_t *)malloc(sizeof(coord_t) * max);
-    if (y == NULL)
+    if (z_curve_grid_multithreaded(cfg->degree, grid, cfg->num_threads))
     {
-        free(x);
-        fprintf(stderr, "%s: error in run_standard: failed to allocate memory for y\n", get_filename(cfg->path));
+        fprintf(stderr, "%s: error in run_grid: failed to start threads\n", get_filename(cfg->path));
+        z_curve_free(grid, bytes);
         return -1;
     }
 
-    if (run_standard_impl(cfg, x, y))
+    printf("Finished generating grid of %zu x %zu cells!\n", width, width);
+
+    if (cfg->degree <= GRID_PRINT_DEGREE_MAX)
+    {
+        for (size_t y = 0; y < width; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                printf("%4u", grid[(y << cfg->degree) | x]);
+            }
+            printf("\n");
+        }
+    }
+
+    z_curve_free(grid, bytes);
+
+    return 0;
+}
+
+/*
+the inverse grid built with an encode per cell, with the SIMD rows and
+with the rows spread over -t threads
+*/
+static inline int benchmark_grid(const config_t *cfg)
+{
+    size_t width = 1ull << cfg->degree;
+    size_t bytes = sizeof(uint32_t) * width * width;
+
+    uint32_t *grid = (uint32_t *)z_curve_alloc(bytes);
+    if (grid == NULL)
     {
-        free(x);
-        free(y);
+        fprintf(stderr, "%s: error in benchmark_grid: failed to allocate memory for the grid\n", get_filename(cfg->path));
         return -1;
     }
 
-    printf("Finished generating zcurve!\n");
+    // fault in the pages first, so the first implementation does not pay for them
+    z_curve_grid_simd(cfg->degree, grid);
 
-    if (cfg->save_svg)
+    struct timespec start;
+    double time_scalar = 0.0, time_simd = 0.0, time_threads = 0.0;
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
     {
-        printf("Saving data to svg...\n");
-        generate_svg_path(cfg->degree, x, y, 2, 10, cfg->svg_filename);
-        printf("Done!\n");
+        start = bench_now();
+        z_curve_grid(cfg->degree, grid);
+        time_scalar += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        z_curve_grid_simd(cfg->degree, grid);
+        time_simd += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        if (z_curve_grid_multithreaded(cfg->degree, grid, cfg->num_threads))
+        {
+            fprintf(stderr, "%s: error in benchmark_grid: failed to start threads\n", get_filename(cfg->path));
+            z_curve_free(grid, bytes);
+            return -1;
+        }
+        time_threads += bench_seconds_since(start);
+
+        sleep(1);
     }
 
-    free(x);
-    free(y);
+    unsigned n = cfg->benchmark_iterations;
+    printf("Grid of degree %u, %zu x %zu cells:\n", cfg->degree, width, width);
+    printf("Encoding every cell took %lf seconds on average\n", time_scalar / n);
+    printf("SIMD rows took %lf seconds on average (%lfx)\n", time_simd / n, time_scalar / time_simd);
+    printf("SIMD rows on %u threads took %lf seconds on average (%lfx)\n", cfg->num_threads, time_threads / n, time_scalar / time_threads);
+
+    z_curve_free(grid, bytes);
 
     return 0;
 }
 
-static inline int run_benchmark(const config_t *cfg)
+static inline float pyramid_row_major_combine(float a, float b, pyramid_op_t op)
 {
-    switch (cfg->mode)
+    switch (op)
     {
-    case STANDARD:
-        printf("Running implementation: %s\n", impl_to_string(cfg->implementation, cfg->mode));
-        return benchmark_standard(cfg);
-    case INDEX:
-        return benchmark_index(cfg);
-    case POSITION:
-        return benchmark_position(cfg);
+    case PYRAMID_MIN:
+        return a < b ? a : b;
+    case PYRAMID_MAX:
+        return a > b ? a : b;
     default:
-        fprintf(stderr, "%s: argument error: invalid mode\n", get_filename(cfg->path));
-        return -1;
+        return a + b;
     }
+}
 
-    return 0;
+// the row-major way: every coarser cell gathers its 2x2 children from two rows of the finer level
+static void pyramid_row_major(unsigned degree, const float *image, float *pyramid, pyramid_op_t op)
+{
+    const float *src = image;
+
+    for (unsigned level = degree; level-- > 0;)
+    {
+        size_t width = 1ull << level;
+        float *dst = z_curve_pyramid_level(degree, level, pyramid);
+
+        for (size_t y = 0; y < width; ++y)
+        {
+            const float *top = &src[(2 * y) * (2 * width)];
+            const float *bottom = &src[(2 * y + 1) * (2 * width)];
+
+            for (size_t x = 0; x < width; ++x)
+            {
+                float value = pyramid_row_major_combine(pyramid_row_major_combine(top[2 * x], top[2 * x + 1], op),
+                                                        pyramid_row_major_combine(bottom[2 * x], bottom[2 * x + 1], op), op);
+
+                dst[y * width + x] = op == PYRAMID_MEAN ? value * 0.25f : value;
+            }
+        }
+
+        src = dst;
+    }
 }
 
-static inline int run_default(const config_t *cfg)
+/*
+the same values once in Z order and once as a row-major image: the
+pyramid over the Z order reduces contiguous groups of four, the
+row-major one gathers each 2x2 block from two rows
+*/
+static inline int benchmark_pyramid(const config_t *cfg)
 {
-    switch (cfg->mode)
+    size_t max = 1ull << (cfg->degree * 2);
+    size_t levels = z_curve_pyramid_size(cfg->degree);
+
+    bench_buffers_t buffers = {0};
+    float *values = (float *)bench_alloc(&buffers, sizeof(float) * max);
+    float *image = (float *)bench_alloc(&buffers, sizeof(float) * max);
+    float *pyramid = (float *)bench_alloc(&buffers, sizeof(float) * levels);
+
+    if (buffers.failed)
     {
-    case STANDARD:
-        printf("You have chosen version: %s\n", impl_to_string(cfg->implementation, cfg->mode));
-        return run_standard(cfg);
-    case INDEX:
-        return run_index(cfg);
-    case POSITION:
-        return run_position(cfg);
-    default:
-        fprintf(stderr, "%s: argument error: invalid mode\n", get_filename(cfg->path));
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in benchmark_pyramid: failed to allocate memory\n", get_filename(cfg->path));
         return -1;
     }
 
+    uint64_t state = BENCH_SEED;
+    for (size_t idx = 0; idx < max; ++idx)
+    {
+        coord_t x = 0, y = 0;
+        z_curve_magic_at(cfg->degree, idx, &x, &y);
+
+        values[idx] = (float)(bench_random(&state) & 0xff);
+        image[((size_t)y << cfg->degree) | x] = values[idx];
+    }
+
+    struct timespec start;
+    double time_row_major = 0.0, time_zorder = 0.0, time_threads = 0.0;
+
+    // keeps the pyramids from being optimised away
+    float top = 0.0f;
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+    {
+        start = bench_now();
+        pyramid_row_major(cfg->degree, image, pyramid, cfg->pyramid_op);
+        time_row_major += bench_seconds_since(start);
+        top += pyramid[levels - 1];
+
+        sleep(1);
+
+        start = bench_now();
+        z_curve_pyramid(cfg->degree, values, pyramid, cfg->pyramid_op);
+        time_zorder += bench_seconds_since(start);
+        top += pyramid[levels - 1];
+
+        sleep(1);
+
+        start = bench_now();
+        if (z_curve_pyramid_multithreaded(cfg->degree, values, pyramid, cfg->pyramid_op, cfg->num_threads))
+        {
+            fprintf(stderr, "%s: error in benchmark_pyramid: failed to start threads\n", get_filename(cfg->path));
+            bench_free(&buffers);
+            return -1;
+        }
+        time_threads += bench_seconds_since(start);
+        top += pyramid[levels - 1];
+
+        sleep(1);
+    }
+
+    unsigned n = cfg->benchmark_iterations;
+    printf("%s pyramid of degree %u, %zu levels above %zu values (top %f):\n", pyramid_op_to_string(cfg->pyramid_op), cfg->degree, (size_t)cfg->degree, max, top / (3 * n));
+    printf("Row-major 2x2 gathers took %lf seconds on average\n", time_row_major / n);
+    printf("Z order groups of four took %lf seconds on average (%lfx)\n", time_zorder / n, time_row_major / time_zorder);
+    printf("Z order groups of four on %u threads took %lf seconds on average (%lfx)\n", cfg->num_threads, time_threads / n, time_row_major / time_threads);
+
+    bench_free(&buffers);
+
     return 0;
 }
 
-void print_help(const char *path)
+// spreads the 32 bits of v over the even bits of the result
+static inline uint64_t dilate32(uint32_t v)
 {
-    const char *program_name = get_filename(path);
-    printf(USAGE, program_name, program_name, program_name, program_name, program_name);
+    uint64_t z = v;
+
+    z = (z | (z << 16)) & 0x0000ffff0000ffff;
+    z = (z | (z << 8)) & 0x00ff00ff00ff00ff;
+    z = (z | (z << 4)) & 0x0f0f0f0f0f0f0f0f;
+    z = (z | (z << 2)) & 0x3333333333333333;
+    z = (z | (z << 1)) & 0x5555555555555555;
+
+    return z;
 }
 
-void print_available_implementations_for_mode(mode_of_operation_t mode)
+/*
+the baseline the key-free sort replaces: a 64 bit key and the position
+of every point, an LSD radix sort of the keys that carries the positions
+along, and a gather of the points in their new order
+*/
+static int radix_sort_points(const point32_t *points, point32_t *sorted, size_t count)
 {
-    switch (mode)
+    const size_t buckets = 1ull << SORT_BENCHMARK_RADIX_BITS;
+
+    uint64_t *keys = (uint64_t *)malloc(sizeof(uint64_t) * count * 2);
+    uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * count * 2);
+    size_t *offsets = (size_t *)malloc(sizeof(size_t) * buckets);
+
+    if (keys == NULL || order == NULL || offsets == NULL)
     {
-    case STANDARD:
-        for (int i = 0; i < MAX_IMPL; i++)
+        free(keys);
+        free(order);
+        free(offsets);
+        return -1;
+    }
+
+    uint64_t *keys_tmp = &keys[count];
+    uint32_t *order_tmp = &order[count];
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        keys[i] = dilate32(points[i].x) | (dilate32(points[i].y) << 1);
+        order[i] = (uint32_t)i;
+    }
+
+    for (unsigned shift = 0; shift < 64; shift += SORT_BENCHMARK_RADIX_BITS)
+    {
+        memset(offsets, 0, sizeof(size_t) * buckets);
+
+        for (size_t i = 0; i < count; ++i)
         {
-            printf("\t%s : %d\n", standard_impl_to_string((standard_impl_t)i), i);
+            ++offsets[(keys[i] >> shift) & (buckets - 1)];
         }
-        break;
-    case INDEX:
-        for (int i = 0; i < INDEX_MAX_IMPL; i++)
+
+        size_t sum = 0;
+        for (size_t b = 0; b < buckets; ++b)
         {
-            printf("\t%s : %d\n", index_impl_to_string((index_impl_t)i), i);
+            size_t n = offsets[b];
+            offsets[b] = sum;
+            sum += n;
         }
-        break;
-    case POSITION:
-        for (int i = 0; i < POSITION_MAX_IMPL; i++)
+
+        for (size_t i = 0; i < count; ++i)
         {
-            printf("\t%s : %d\n", position_impl_to_string((position_impl_t)i), i);
+            size_t dst = offsets[(keys[i] >> shift) & (buckets - 1)]++;
+            keys_tmp[dst] = keys[i];
+            order_tmp[dst] = order[i];
         }
-        break;
-    default:
-        break;
+
+        uint64_t *swap_keys = keys;
+        keys = keys_tmp;
+        keys_tmp = swap_keys;
+
+        uint32_t *swap_order = order;
+        order = order_tmp;
+        order_tmp = swap_order;
     }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        sorted[i] = points[order[i]];
+    }
+
+    // an even number of passes leaves both arrays where they started
+    free(keys);
+    free(order);
+    free(offsets);
+
+    return 0;
 }
 
-void print_available_implementations()
+/*
+4^d random points sorted into Z order with the key-free comparison, on
+one and on -t threads, against encoding 64 bit keys and radix sorting
+them. Every iteration sorts a fresh copy of the same points
+*/
+static inline int benchmark_sort(const config_t *cfg)
 {
+    size_t count = 1ull << (cfg->degree * 2);
+
+    bench_buffers_t buffers = {0};
+    point32_t *points = (point32_t *)bench_alloc(&buffers, sizeof(point32_t) * count);
+    point32_t *sorted = (point32_t *)bench_alloc(&buffers, sizeof(point32_t) * count);
+    point32_t *reference = (point32_t *)bench_alloc(&buffers, sizeof(point32_t) * count);
+
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in benchmark_sort: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    uint64_t state = BENCH_SEED;
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint64_t value = bench_random(&state);
+
+        points[i].x = (uint32_t)value;
+        points[i].y = (uint32_t)(value >> 32);
+    }
+
+    struct timespec start;
+    double time_radix = 0.0, time_sort = 0.0, time_parallel = 0.0;
+    bool match = true;
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+    {
+        start = bench_now();
+        if (radix_sort_points(points, reference, count))
+        {
+            fprintf(stderr, "%s: error in benchmark_sort: failed to allocate memory for the keys\n", get_filename(cfg->path));
+            bench_free(&buffers);
+            return -1;
+        }
+        time_radix += bench_seconds_since(start);
+
+        sleep(1);
+
+        memcpy(sorted, points, sizeof(point32_t) * count);
+        start = bench_now();
+        z_curve_sort(sorted, count);
+        time_sort += bench_seconds_since(start);
+        match = match && !memcmp(sorted, reference, sizeof(point32_t) * count);
+
+        sleep(1);
+
+        memcpy(sorted, points, sizeof(point32_t) * count);
+        start = bench_now();
+        z_curve_sort_parallel(sorted, count, cfg->num_threads);
+        time_parallel += bench_seconds_since(start);
+        match = match && !memcmp(sorted, reference, sizeof(point32_t) * count);
+
+        sleep(1);
+    }
+
+    unsigned n = cfg->benchmark_iterations;
+    printf("Sorting %zu points into Z order, the sorts %s:\n", count, match ? "agree" : "DISAGREE");
+    printf("Encoding and radix sorting took %lf seconds on average and %zu bytes besides the points\n",
+           time_radix / n, (sizeof(uint64_t) + sizeof(uint32_t)) * 2 * count + sizeof(size_t) * ((size_t)1 << SORT_BENCHMARK_RADIX_BITS));
+    printf("Key-free introsort took %lf seconds on average (%lfx)\n", time_sort / n, time_radix / time_sort);
+    printf("Key-free introsort on %u threads took %lf seconds on average (%lfx)\n", cfg->num_threads, time_parallel / n, time_radix / time_parallel);
+
+    bench_free(&buffers);
+
+    return match ? 0 : -1;
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    size_t lhs = *(const size_t *)a;
+    size_t rhs = *(const size_t *)b;
+
+    return lhs < rhs ? -1 : lhs > rhs;
+}
+
+/*
+the linear quadtree over the sorted keys of random points: building it,
+locating random points, counting the points in random rectangles of up
+to a sixteenth of the side and walking every level
+*/
+static inline int benchmark_quadtree(const config_t *cfg)
+{
+    size_t count = QUADTREE_BENCHMARK_POINTS;
+    size_t mask = (1ull << cfg->degree) - 1;
+
+    bench_buffers_t buffers = {0};
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    size_t *keys = (size_t *)bench_alloc(&buffers, sizeof(size_t) * count);
+    coord_t *queries = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * 4 * QUADTREE_BENCHMARK_QUERIES);
+
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in benchmark_quadtree: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    uint64_t state = BENCH_SEED;
+    bench_random_points(&state, x, y, count, cfg->degree);
+
+    for (size_t i = 0; i < QUADTREE_BENCHMARK_QUERIES; ++i)
+    {
+        uint64_t value = bench_random(&state);
+
+        size_t side = ((value >> 40) & (mask >> 4)) + 1;
+        queries[4 * i] = (coord_t)(value & mask);
+        queries[4 * i + 1] = (coord_t)((value >> 20) & mask);
+        queries[4 * i + 2] = (coord_t)(queries[4 * i] + side > mask ? mask : queries[4 * i] + side);
+        queries[4 * i + 3] = (coord_t)(queries[4 * i + 1] + side > mask ? mask : queries[4 * i + 1] + side);
+    }
+
+    z_curve_shuffle_pos_batch(x, y, count, keys);
+    qsort(keys, count, sizeof(size_t), compare_keys);
+
+    struct timespec start;
+    double time_build = 0.0, time_locate = 0.0, time_count = 0.0, time_levels = 0.0;
+
+    // keeps the queries from being optimised away
+    size_t sum = 0, leaves = 0;
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+    {
+        z_quadtree_t tree;
+
+        start = bench_now();
+        int result = z_quadtree_build(&tree, cfg->degree, keys, count, cfg->quadtree_capacity);
+        time_build += bench_seconds_since(start);
+
+        if (result)
+        {
+            fprintf(stderr, "%s: error in benchmark_quadtree: failed to allocate memory for the leaves\n", get_filename(cfg->path));
+            bench_free(&buffers);
+            return -1;
+        }
+
+        leaves = tree.num_leaves;
+
+        start = bench_now();
+        for (size_t q = 0; q < QUADTREE_BENCHMARK_QUERIES; ++q)
+        {
+            sum += z_quadtree_locate(&tree, queries[4 * q], queries[4 * q + 1]);
+        }
+        time_locate += bench_seconds_since(start);
+
+        start = bench_now();
+        for (size_t q = 0; q < QUADTREE_BENCHMARK_QUERIES; ++q)
+        {
+            sum += z_quadtree_count(&tree, queries[4 * q], queries[4 * q + 1], queries[4 * q + 2], queries[4 * q + 3]);
+        }
+        time_count += bench_seconds_since(start);
+
+        start = bench_now();
+        for (unsigned level = 0; level <= cfg->degree; ++level)
+        {
+            z_quadtree_iter_t iter;
+            quadtree_cell_t cell;
+
+            z_quadtree_level_begin(&iter, &tree, level);
+            while (z_quadtree_level_next(&iter, &cell))
+            {
+                sum += cell.end - cell.begin;
+            }
+        }
+        time_levels += bench_seconds_since(start);
+
+        z_quadtree_destroy(&tree);
+
+        sleep(1);
+    }
+
+    unsigned n = cfg->benchmark_iterations;
+    printf("Quadtree over %zu points of degree %u, %zu leaves of at most %zu points (checksum %zu):\n", count, cfg->degree, leaves, cfg->quadtree_capacity, sum);
+    printf("Building took %lf seconds on average\n", time_build / n);
+    printf("Locating %u points took %lf seconds on average\n", QUADTREE_BENCHMARK_QUERIES, time_locate / n);
+    printf("Counting %u rectangles took %lf seconds on average\n", QUADTREE_BENCHMARK_QUERIES, time_count / n);
+    printf("Walking the cells of all %u levels took %lf seconds on average\n", cfg->degree + 1, time_levels / n);
+
+    bench_free(&buffers);
+
+    return 0;
+}
+
+/*
+the distance join and the cell join at the same level of two sets of
+random points, on one thread and on -t threads
+*/
+static inline int benchmark_join(const config_t *cfg)
+{
+    size_t count = JOIN_BENCHMARK_POINTS;
+
+    bench_buffers_t buffers = {0};
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    size_t *a = (size_t *)bench_alloc(&buffers, sizeof(size_t) * count);
+    size_t *b = (size_t *)bench_alloc(&buffers, sizeof(size_t) * count);
+
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in benchmark_join: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    uint64_t state = BENCH_SEED;
+    size_t *sets[] = {a, b};
+
+    for (unsigned set = 0; set < 2; ++set)
+    {
+        bench_random_points(&state, x, y, count, cfg->degree);
+        z_curve_shuffle_pos_batch(x, y, count, sets[set]);
+        qsort(sets[set], count, sizeof(size_t), compare_keys);
+    }
+
+    join_input_t input = {.degree = cfg->degree, .a = a, .a_count = count, .b = b, .b_count = count, .fn = NULL, .arg = NULL};
+    unsigned level = z_curve_join_level(cfg->degree, cfg->join_radius);
+
+    struct timespec start;
+    double time_distance = 0.0, time_distance_threads = 0.0, time_cells = 0.0, time_cells_threads = 0.0;
+    size_t distance_pairs = 0, distance_pairs_threads = 0, cell_pairs = 0, cell_pairs_threads = 0;
+    int result = 0;
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations && !result; ++i)
+    {
+        start = bench_now();
+        distance_pairs = z_curve_join_distance(&input, cfg->join_radius);
+        time_distance += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        result |= z_curve_join_distance_multithreaded(&input, cfg->join_radius, cfg->num_threads, &distance_pairs_threads);
+        time_distance_threads += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        cell_pairs = z_curve_join_cells(&input, level);
+        time_cells += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        result |= z_curve_join_cells_multithreaded(&input, level, cfg->num_threads, &cell_pairs_threads);
+        time_cells_threads += bench_seconds_since(start);
+
+        sleep(1);
+    }
+
+    if (result)
+    {
+        fprintf(stderr, "%s: error in benchmark_join: failed to start threads\n", get_filename(cfg->path));
+    }
+    else
+    {
+        unsigned n = cfg->benchmark_iterations;
+        printf("Joining two sets of %zu points of degree %u, the joins %s:\n", count, cfg->degree,
+               distance_pairs == distance_pairs_threads && cell_pairs == cell_pairs_threads ? "agree" : "DISAGREE");
+        printf("%zu pairs at most %u apart took %lf seconds on average\n", distance_pairs, cfg->join_radius, time_distance / n);
+        printf("The same on %u threads took %lf seconds on average (%lfx)\n", cfg->num_threads, time_distance_threads / n, time_distance / time_distance_threads);
+        printf("%zu pairs sharing a cell of level %u took %lf seconds on average\n", cell_pairs, level, time_cells / n);
+        printf("The same on %u threads took %lf seconds on average (%lfx)\n", cfg->num_threads, time_cells_threads / n, time_cells / time_cells_threads);
+    }
+
+    bench_free(&buffers);
+
+    return result ? -1 : 0;
+}
+
+typedef void (*batch_decoder_t)(const size_t *idx, size_t count, coord_t *x, coord_t *y);
+
+/*
+random batch decode with the magic bits, the pshufb nibble tables and the
+gathers on the 8 and 16 bit tables. Indices, x and y take 12 bytes per
+point, the batch sizes grow by 16x from inside L1 to main memory
+*/
+static inline int benchmark_batch_decoders(const config_t *cfg)
+{
+    static const batch_decoder_t decoders[] = {z_curve_magic_batch_at, z_curve_shuffle_batch_at, z_curve_simd_lookup_8bit_batch_at, z_curve_simd_lookup_16bit_batch_at};
+    static const char *const names[] = {"ZCURVE_MAGIC", "ZCURVE_SHUFFLE", "ZCURVE_LOOKUP_GATHER_8BIT", "ZCURVE_LOOKUP_GATHER_16BIT"};
+
+    size_t max = 1ull << (cfg->degree * 2);
+
+    bench_buffers_t buffers = {0};
+    size_t *idx = (size_t *)bench_alloc(&buffers, sizeof(size_t) * BATCH_BENCHMARK_POINTS_MAX);
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * BATCH_BENCHMARK_POINTS_MAX);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * BATCH_BENCHMARK_POINTS_MAX);
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in benchmark_batch_decoders: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    uint64_t state = BENCH_SEED;
+    bench_random_indices(&state, idx, BATCH_BENCHMARK_POINTS_MAX, max);
+
+    printf("Batch decode of random indices%s\n", cpu_has_avx2() ? "" : " (no AVX2: gathers fall back to scalar lookups)");
+
+    for (size_t count = BATCH_BENCHMARK_POINTS_MIN; count <= BATCH_BENCHMARK_POINTS_MAX; count <<= 4)
+    {
+        // repeat small batches so every measurement decodes about the same number of points
+        unsigned repetitions = BATCH_BENCHMARK_POINTS_MAX / count;
+
+        printf("%zu points (%zu KiB working set):\n", count, count * (sizeof(size_t) + 2 * sizeof(coord_t)) >> 10);
+
+        for (size_t d = 0; d < sizeof(decoders) / sizeof(decoders[0]); ++d)
+        {
+            struct timespec start;
+            double time_total = 0.0;
+
+            // the first pass warms the caches and tables
+            decoders[d](idx, count, x, y);
+            sleep(1);
+
+            for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+            {
+                start = bench_now();
+                for (unsigned r = 0; r < repetitions; ++r)
+                {
+                    decoders[d](idx, count, x, y);
+                }
+                time_total += bench_seconds_since(start);
+            }
+
+            printf("\t%s: %f ns per point\n", names[d], time_total * 1e9 / ((double)count * repetitions * cfg->benchmark_iterations));
+        }
+    }
+
+    bench_free(&buffers);
+
+    return 0;
+}
+
+// the 8 bit batch decoders need every index below 4^COORD8_DEGREE_MAX, larger degrees take the 16 bit magic kernel
+static inline bool batch_use_8bit(const config_t *cfg)
+{
+    return z_curve_fits_8bit(cfg->degree) &&
+           (cfg->implementation == BATCH_ZCURVE_MAGIC_8BIT || cfg->implementation == BATCH_ZCURVE_MAGIC_SIMD_8BIT);
+}
+
+static inline const char *batch_kernel_to_string(const config_t *cfg)
+{
+    if (!batch_use_8bit(cfg))
+    {
+        return cfg->implementation == BATCH_ZCURVE_MAGIC_8BIT || cfg->implementation == BATCH_ZCURVE_MAGIC_SIMD_8BIT
+                   ? "ZCURVE_MAGIC, degree too large for 8 bit coordinates"
+                   : batch_impl_to_string((batch_impl_t)cfg->implementation);
+    }
+
+    if (cfg->implementation == BATCH_ZCURVE_MAGIC_8BIT)
+    {
+        return "ZCURVE_MAGIC_8BIT";
+    }
+
+    return cpu_has_avx2() ? "ZCURVE_MAGIC_SIMD_8BIT, AVX2" : "ZCURVE_MAGIC_SIMD_8BIT, SSE";
+}
+
+// x8 and y8 take the points when batch_use_8bit, x and y otherwise
+static inline int run_batch_impl(const config_t *cfg, const size_t *idx, size_t count, coord_t *x, coord_t *y, coord8_t *x8, coord8_t *y8)
+{
+    if (batch_use_8bit(cfg))
+    {
+        if (cfg->implementation == BATCH_ZCURVE_MAGIC_SIMD_8BIT)
+        {
+            z_curve_simd_magic_batch_at_8bit(idx, count, x8, y8);
+        }
+        else
+        {
+            z_curve_magic_batch_at_8bit(idx, count, x8, y8);
+        }
+
+        return 0;
+    }
+
+    switch (cfg->implementation)
+    {
+    case BATCH_ZCURVE_MAGIC:
+    case BATCH_ZCURVE_MAGIC_8BIT:
+    case BATCH_ZCURVE_MAGIC_SIMD_8BIT:
+        z_curve_magic_batch_at(idx, count, x, y);
+        break;
+    case BATCH_ZCURVE_MULTITHREADED:
+        if (z_curve_multithreaded_batch_at(idx, count, x, y, cfg->num_threads))
+        {
+            fprintf(stderr, "%s: failed to run multithreaded implementation\n", get_filename(cfg->path));
+            return -1;
+        }
+        break;
+    case BATCH_ZCURVE_SHUFFLE:
+        z_curve_shuffle_batch_at(idx, count, x, y);
+        break;
+    case BATCH_ZCURVE_LOOKUP_GATHER_8BIT:
+        z_curve_simd_lookup_8bit_batch_at(idx, count, x, y);
+        break;
+    case BATCH_ZCURVE_LOOKUP_GATHER_16BIT:
+        z_curve_simd_lookup_16bit_batch_at(idx, count, x, y);
+        break;
+    case BATCH_ZCURVE_LOOKUP_SEQUENTIAL:
+        // made for ascending indices, random ones share their high bits only now and then
+        z_curve_lookup_sequential_batch_at(idx, count, x, y);
+        break;
+    default:
+        fprintf(stderr, "%s: unknown implementation\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    return 0;
+}
+
+// FNV-1a over the points in order, the same for every correct batch decoder
+static inline uint64_t batch_checksum(const coord_t *x, const coord_t *y, size_t count)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        hash = (hash ^ (((uint64_t)y[i] << 16) | x[i])) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/*
+-b random indices of degree -d, the same on every run, decoded with one
+batch decoder. With -B the first batch warms the caches and tables and
+the following ones are timed
+*/
+static inline int run_batch(const config_t *cfg)
+{
+    size_t count = cfg->batch_count;
+    size_t max = 1ull << (cfg->degree * 2);
+
+    bench_buffers_t buffers = {0};
+    size_t *idx = (size_t *)bench_alloc(&buffers, sizeof(size_t) * count);
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+
+    bool narrow = batch_use_8bit(cfg);
+    coord8_t *x8 = narrow ? (coord8_t *)bench_alloc(&buffers, sizeof(coord8_t) * count) : NULL;
+    coord8_t *y8 = narrow ? (coord8_t *)bench_alloc(&buffers, sizeof(coord8_t) * count) : NULL;
+
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in run_batch: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    uint64_t state = BENCH_SEED;
+    bench_random_indices(&state, idx, count, max);
+
+    if (run_batch_impl(cfg, idx, count, x, y, x8, y8))
+    {
+        bench_free(&buffers);
+        return -1;
+    }
+
+    // the checksum is taken over full width points, whichever kernel ran
+    if (narrow)
+    {
+        z_curve_widen_8bit(x8, x, count);
+        z_curve_widen_8bit(y8, y, count);
+    }
+
+    printf("%s: Decoded %zu random indices for degree %u with kernel %s, checksum %016llx\n", impl_to_string(cfg->implementation, cfg->mode),
+           count, cfg->degree, batch_kernel_to_string(cfg), (unsigned long long)batch_checksum(x, y, count));
+
+    if (cfg->should_benchmark)
+    {
+        struct timespec start;
+        double time_total = 0.0;
+
+        for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+        {
+            sleep(1);
+
+            start = bench_now();
+            if (run_batch_impl(cfg, idx, count, x, y, x8, y8))
+            {
+                bench_free(&buffers);
+                return -1;
+            }
+            time_total += bench_seconds_since(start);
+        }
+
+        printf("Benchmarking implementation %s for %u iterations took %f seconds on average (%f ns per point)\n",
+               impl_to_string(cfg->implementation, cfg->mode), cfg->benchmark_iterations,
+               time_total / cfg->benchmark_iterations, time_total * 1e9 / ((double)count * cfg->benchmark_iterations));
+    }
+
+    bench_free(&buffers);
+
+    return 0;
+}
+
+// the batch encoders take the whole array, every other position implementation one point at a time
+static inline int run_position_batch_impl(const config_t *cfg, const coord_t *x, const coord_t *y, size_t count, size_t *idx)
+{
+    switch (cfg->implementation)
+    {
+    case POSITION_ZCURVE_LOOKUP_16BIT_BATCH:
+        z_curve_lookup_16bit_pos_batch(x, y, count, idx);
+        return 0;
+    case POSITION_ZCURVE_SIMD_LOOKUP_16BIT_BATCH:
+        z_curve_simd_lookup_16bit_pos_batch(x, y, count, idx);
+        return 0;
+    default:
+        break;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        switch (cfg->implementation)
+        {
+        case POSITION_ZCURVE:
+            idx[i] = z_curve_pos(cfg->degree, x[i], y[i]);
+            break;
+        case POSITION_ZCURVE_MAGIC:
+            idx[i] = z_curve_magic_pos(cfg->degree, x[i], y[i]);
+            break;
+        case POSITION_ZCURVE_LOOKUP_16BIT:
+            idx[i] = z_curve_lookup_16bit_pos(cfg->degree, x[i], y[i]);
+            break;
+        case POSITION_ZCURVE_LOOKUP_8BIT:
+            idx[i] = z_curve_lookup_8bit_pos(cfg->degree, x[i], y[i]);
+            break;
+        case POSITION_ZCURVE_LOOKUP_4BIT:
+            idx[i] = z_curve_lookup_4bit_pos(cfg->degree, x[i], y[i]);
+            break;
+        case POSITION_ZCURVE_SHUFFLE:
+            idx[i] = z_curve_shuffle_pos(cfg->degree, x[i], y[i]);
+            break;
+        default:
+            fprintf(stderr, "%s: error in run_position_batch: invalid implementation\n", get_filename(cfg->path));
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// FNV-1a over the indices in order, the same for every correct encoder
+static inline uint64_t position_batch_checksum(const size_t *idx, size_t count)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        hash = (hash ^ idx[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+// -p with -b: random points of degree -d encoded with one position implementation, timed like run_batch
+static inline int run_position_batch(const config_t *cfg)
+{
+    size_t count = cfg->batch_count;
+
+    bench_buffers_t buffers = {0};
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * count);
+    size_t *idx = (size_t *)bench_alloc(&buffers, sizeof(size_t) * count);
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in run_position_batch: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    uint64_t state = BENCH_SEED;
+    bench_random_points(&state, x, y, count, cfg->degree);
+
+    if (run_position_batch_impl(cfg, x, y, count, idx))
+    {
+        bench_free(&buffers);
+        return -1;
+    }
+
+    printf("%s: Encoded %zu random points for degree %u, checksum %016llx\n", impl_to_string(cfg->implementation, cfg->mode),
+           count, cfg->degree, (unsigned long long)position_batch_checksum(idx, count));
+
+    if (cfg->should_benchmark)
+    {
+        struct timespec start;
+        double time_total = 0.0;
+
+        for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+        {
+            sleep(1);
+
+            start = bench_now();
+            if (run_position_batch_impl(cfg, x, y, count, idx))
+            {
+                bench_free(&buffers);
+                return -1;
+            }
+            time_total += bench_seconds_since(start);
+        }
+
+        printf("Benchmarking implementation %s for %u iterations took %f seconds on average (%f ns per point)\n",
+               impl_to_string(cfg->implementation, cfg->mode), cfg->benchmark_iterations,
+               time_total / cfg->benchmark_iterations, time_total * 1e9 / ((double)count * cfg->benchmark_iterations));
+    }
+
+    bench_free(&buffers);
+
+    return 0;
+}
+
+static inline int run_standard_impl(const config_t *cfg, coord_t *x, coord_t *y, numa_stats_t *stats)
+{
+    switch (cfg->implementation)
+    {
+    case ZCURVE:
+        z_curve(cfg->degree, x, y);
+        break;
+    case ZCURVE_MULTITHREADED:
+        if (z_curve_multithreaded_stats(cfg->degree, x, y, cfg->num_threads, stats))
+        {
+            fprintf(stderr, "%s: failed to run multithreaded implementation\n", get_filename(cfg->path));
+            return -1;
+        }
+        break;
+    case ZCURVE_LOOKUP_4BIT:
+        z_curve_lookup_4bit(cfg->degree, x, y);
+        break;
+    case ZCURVE_LOOKUP_8BIT:
+        z_curve_lookup_8bit(cfg->degree, x, y);
+        break;
+    case ZCURVE_LOOKUP_16BIT:
+        z_curve_lookup_16bit(cfg->degree, x, y);
+        break;
+    case ZCURVE_MAGIC:
+        z_curve_magic(cfg->degree, x, y);
+        break;
+    case ZCURVE_SIMD:
+        z_curve_simd(cfg->degree, x, y);
+        break;
+    case ZCURVE_LOOKUP_SIMD_16BIT:
+        z_curve_simd_lookup_16bit(cfg->degree, x, y);
+        break;
+    case ZCURVE_MAGIC_SIMD:
+        z_curve_simd_magic(cfg->degree, x, y);
+        break;
+    case ZCURVE_LOOKUP_SEQUENTIAL:
+        z_curve_lookup_sequential(cfg->degree, x, y);
+        break;
+    case ZCURVE_LOOKUP_SIMD_SEQUENTIAL:
+        z_curve_simd_lookup_sequential(cfg->degree, x, y);
+        break;
+    case ZCURVE_SHUFFLE:
+        z_curve_shuffle(cfg->degree, x, y);
+        break;
+    case ZCURVE_LOOKUP_RUNTIME:
+        z_curve_lookup_runtime(cfg->degree, x, y);
+        break;
+    default:
+        fprintf(stderr, "%s: unknown implementation\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    return 0;
+}
+
+// small curves of the magic implementations are generated with 8 bit coordinates
+static inline bool use_8bit(const config_t *cfg)
+{
+    return z_curve_fits_8bit(cfg->degree) && cfg->layout == OUTPUT_SOA &&
+           (cfg->implementation == ZCURVE_MAGIC || cfg->implementation == ZCURVE_MAGIC_SIMD);
+}
+
+static inline void run_8bit_impl(const config_t *cfg, coord8_t *x, coord8_t *y)
+{
+    if (cfg->implementation == ZCURVE_MAGIC_SIMD)
+    {
+        z_curve_simd_magic_8bit(cfg->degree, x, y);
+    }
+    else
+    {
+        z_curve_magic_8bit(cfg->degree, x, y);
+    }
+}
+
+static inline int benchmark_8bit(const config_t *cfg)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+    coord8_t *x = (coord8_t *)z_curve_alloc(sizeof(coord8_t) * max);
+    coord8_t *y = (coord8_t *)z_curve_alloc(sizeof(coord8_t) * max);
+    if (x == NULL || y == NULL)
+    {
+        z_curve_free(x, sizeof(coord8_t) * max);
+        z_curve_free(y, sizeof(coord8_t) * max);
+        fprintf(stderr, "%s: error in benchmark_8bit: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    printf("Using 8-bit coordinates, kernel %s\n", cfg->implementation == ZCURVE_MAGIC_SIMD ? "ZCURVE_MAGIC_SIMD_8BIT" : "ZCURVE_MAGIC_8BIT");
+
+    unsigned long n = cfg->benchmark_iterations;
+    struct timespec start;
+    double time_total = 0.0;
+
+    while (n--)
+    {
+        start = bench_now();
+        run_8bit_impl(cfg, x, y);
+        time_total += bench_seconds_since(start);
+
+        sleep(1);
+    }
+
+    if (cfg->benchmark_iterations == 1)
+    {
+        printf("One repetition takes %lf seconds\n", time_total);
+    }
+    else
+    {
+        printf("%u repetitions took %lf seconds on average\n", cfg->benchmark_iterations, time_total / cfg->benchmark_iterations);
+    }
+
+    z_curve_free(x, sizeof(coord8_t) * max);
+    z_curve_free(y, sizeof(coord8_t) * max);
+
+    return 0;
+}
+
+// pairs and keys share the memory layout, only the element type differs
+static inline void run_layout_impl(const config_t *cfg, point_t *points)
+{
+    bool simd = cfg->implementation == ZCURVE_MAGIC_SIMD;
+
+    if (cfg->layout == OUTPUT_KEYS)
+    {
+        point_key_t *keys = (point_key_t *)points;
+        simd ? z_curve_simd_magic_keys(cfg->degree, keys) : z_curve_magic_keys(cfg->degree, keys);
+    }
+    else
+    {
+        simd ? z_curve_simd_magic_aos(cfg->degree, points) : z_curve_magic_aos(cfg->degree, points);
+    }
+}
+
+static inline int benchmark_layout(const config_t *cfg)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+    point_t *points = (point_t *)z_curve_alloc(sizeof(point_t) * max);
+    if (points == NULL)
+    {
+        fprintf(stderr, "%s: error in benchmark_layout: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    printf("Using layout %s\n", output_layout_to_string(cfg->layout));
+
+    unsigned long n = cfg->benchmark_iterations;
+    struct timespec start;
+    double time_total = 0.0;
+
+    while (n--)
+    {
+        start = bench_now();
+        run_layout_impl(cfg, points);
+        time_total += bench_seconds_since(start);
+
+        sleep(1);
+    }
+
+    if (cfg->benchmark_iterations == 1)
+    {
+        printf("One repetition takes %lf seconds\n", time_total);
+    }
+    else
+    {
+        printf("%u repetitions took %lf seconds on average\n", cfg->benchmark_iterations, time_total / cfg->benchmark_iterations);
+    }
+
+    z_curve_free(points, sizeof(point_t) * max);
+
+    return 0;
+}
+
+static inline int benchmark_packed(const config_t *cfg, coord_t *x, coord_t *y)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+
+    packed_curve_t packed;
+    if (z_curve_packed_encode(&packed, cfg->degree, x, y))
+    {
+        fprintf(stderr, "%s: error in benchmark_packed: failed to compress zcurve\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    // decoding runs from the written file, mapped back the way a reader on another host gets it
+    int written = z_curve_packed_write(&packed, cfg->packed_filename);
+    z_curve_packed_free(&packed);
+
+    if (written || z_curve_packed_open(&packed, cfg->packed_filename, true))
+    {
+        fprintf(stderr, "%s: error in benchmark_packed: failed to write and map back %s\n", get_filename(cfg->path), cfg->packed_filename);
+        return -1;
+    }
+
+    printf("Wrote %s and mapped it back with a matching checksum\n", cfg->packed_filename);
+
+    size_t raw_size = sizeof(coord_t) * 2 * max;
+    printf("Compressed %zu bytes to %zu bytes (ratio %lf, %lf bits per point)\n", raw_size, packed.image_size,
+           (double)raw_size / packed.image_size, packed.image_size * 8.0 / max);
+
+    coord_t *check_x = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    coord_t *check_y = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    if (check_x == NULL || check_y == NULL)
+    {
+        z_curve_free(check_x, sizeof(coord_t) * max);
+        z_curve_free(check_y, sizeof(coord_t) * max);
+        z_curve_packed_free(&packed);
+        fprintf(stderr, "%s: error in benchmark_packed: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    unsigned long n = cfg->benchmark_iterations;
+    struct timespec start;
+    double time_decode = 0.0;
+    double time_generate = 0.0;
+
+    while (n--)
+    {
+        sleep(1);
+
+        // an untimed round of both faults in the arrays and warms the caches, so neither pays for going first
+        z_curve_simd_magic(cfg->degree, check_x, check_y);
+        z_curve_packed_decode(&packed, check_x, check_y);
+
+        start = bench_now();
+        z_curve_simd_magic(cfg->degree, check_x, check_y);
+        time_generate += bench_seconds_since(start);
+
+        start = bench_now();
+        z_curve_packed_decode(&packed, check_x, check_y);
+        time_decode += bench_seconds_since(start);
+    }
+
+    int result = 0;
+    if (memcmp(x, check_x, sizeof(coord_t) * max) || memcmp(y, check_y, sizeof(coord_t) * max))
+    {
+        fprintf(stderr, "%s: error in benchmark_packed: decoded zcurve does not match\n", get_filename(cfg->path));
+        result = -1;
+    }
+    else
+    {
+        time_decode /= cfg->benchmark_iterations;
+        time_generate /= cfg->benchmark_iterations;
+
+        printf("Decoding took %lf seconds on average (%lf GB/s), regenerating with ZCURVE_MAGIC_SIMD %lf seconds\n", time_decode,
+               raw_size / time_decode / 1e9, time_generate);
+        printf("Decoding is %lfx %s than regenerating at degree %u\n", time_generate > time_decode ? time_generate / time_decode : time_decode / time_generate,
+               time_generate > time_decode ? "faster" : "slower", cfg->degree);
+    }
+
+    z_curve_free(check_x, sizeof(coord_t) * max);
+    z_curve_free(check_y, sizeof(coord_t) * max);
+    z_curve_packed_free(&packed);
+
+    return result;
+}
+
+// generates the curve at the start degree, then extends it in place one degree at a time
+static inline int run_extend_impl(const config_t *cfg, coord_t *x, coord_t *y)
+{
+    config_t start = *cfg;
+    start.degree = cfg->extend_from;
+
+    if (run_standard_impl(&start, x, y, NULL))
+    {
+        return -1;
+    }
+
+    for (unsigned degree = cfg->extend_from; degree < cfg->degree; ++degree)
+    {
+        if (z_curve_extend_multithreaded(degree, x, y, cfg->num_threads))
+        {
+            fprintf(stderr, "%s: failed to extend zcurve to degree %u\n", get_filename(cfg->path), degree + 1);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static inline int benchmark_extend(const config_t *cfg)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+    coord_t *x = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    coord_t *y = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    if (x == NULL || y == NULL)
+    {
+        z_curve_free(x, sizeof(coord_t) * max);
+        z_curve_free(y, sizeof(coord_t) * max);
+        fprintf(stderr, "%s: error in benchmark_extend: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    // fault in the pages first, so neither side pays for them
+    if (run_standard_impl(cfg, x, y, NULL))
+    {
+        z_curve_free(x, sizeof(coord_t) * max);
+        z_curve_free(y, sizeof(coord_t) * max);
+        return -1;
+    }
+
+    struct timespec start;
+    double time_extend = 0.0;
+    double time_generate = 0.0;
+
+    for (unsigned i = 0; i < cfg->benchmark_iterations; ++i)
+    {
+        start = bench_now();
+        if (run_extend_impl(cfg, x, y))
+        {
+            z_curve_free(x, sizeof(coord_t) * max);
+            z_curve_free(y, sizeof(coord_t) * max);
+            return -1;
+        }
+        time_extend += bench_seconds_since(start);
+
+        sleep(1);
+
+        start = bench_now();
+        if (run_standard_impl(cfg, x, y, NULL))
+        {
+            z_curve_free(x, sizeof(coord_t) * max);
+            z_curve_free(y, sizeof(coord_t) * max);
+            return -1;
+        }
+        time_generate += bench_seconds_since(start);
+
+        sleep(1);
+    }
+
+    printf("Generating degree %u and extending to degree %u took %lf seconds on average\n", cfg->extend_from, cfg->degree, time_extend / cfg->benchmark_iterations);
+    printf("Generating degree %u directly took %lf seconds on average (%lfx)\n", cfg->degree, time_generate / cfg->benchmark_iterations, time_generate / time_extend);
+
+    z_curve_free(x, sizeof(coord_t) * max);
+    z_curve_free(y, sizeof(coord_t) * max);
+
+    return 0;
+}
+
+static inline int benchmark_standard(const config_t *cfg)
+{
+    if (cfg->layout != OUTPUT_SOA)
+    {
+        return benchmark_layout(cfg);
+    }
+
+    if (cfg->extend_from)
+    {
+        return benchmark_extend(cfg);
+    }
+
+    // the compressed format is measured against full width coordinates
+    if (use_8bit(cfg) && !cfg->save_packed)
+    {
+        return benchmark_8bit(cfg);
+    }
+
+    size_t max = 1ull << (cfg->degree * 2);
+    coord_t *x = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    if (x == NULL)
+    {
+        fprintf(stderr, "%s: error in benchmark_standard: failed to allocate memory for x\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    coord_t *y = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    if (y == NULL)
+    {
+        z_curve_free(x, sizeof(coord_t) * max);
+        fprintf(stderr, "%s: error in benchmark_standard: failed to allocate memory for y\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    unsigned long n = cfg->benchmark_iterations;
+    struct timespec start;
+    double time_total = 0.0;
+
+    numa_stats_t stats = {0};
+    numa_stats_t node_total = {0};
+
+    while (n--)
+    {
+        start = bench_now();
+        if (run_standard_impl(cfg, x, y, &stats))
+        {
+            z_curve_free(x, sizeof(coord_t) * max);
+            z_curve_free(y, sizeof(coord_t) * max);
+            return -1;
+        }
+        time_total += bench_seconds_since(start);
+
+        node_total.num_nodes = stats.num_nodes;
+        for (unsigned i = 0; i < stats.num_nodes; ++i)
+        {
+            node_total.node_id[i] = stats.node_id[i];
+            node_total.bytes[i] += stats.bytes[i];
+            node_total.seconds[i] += stats.seconds[i];
+        }
+
+        sleep(1);
+    }
+
+    if (cfg->benchmark_iterations == 1)
+    {
+        printf("One repetition takes %lf seconds\n", time_total);
+    }
+    else
+    {
+        printf("%u repetitions took %lf seconds on average\n", cfg->benchmark_iterations, time_total / cfg->benchmark_iterations);
+    }
+
+    // only the multithreaded implementation fills in per-node statistics
+    for (unsigned i = 0; i < node_total.num_nodes; ++i)
+    {
+        double bandwidth = node_total.seconds[i] > 0.0 ? node_total.bytes[i] / node_total.seconds[i] / 1e9 : 0.0;
+        printf("Node %u wrote %zu bytes per repetition at %lf GB/s\n", node_total.node_id[i],
+               node_total.bytes[i] / cfg->benchmark_iterations, bandwidth);
+    }
+
+    int result = 0;
+    if (cfg->save_packed)
+    {
+        result = benchmark_packed(cfg, x, y);
+    }
+
+    z_curve_free(x, sizeof(coord_t) * max);
+    z_curve_free(y, sizeof(coord_t) * max);
+
+    return result;
+}
+
+static inline block_kernel_t pipeline_kernel(standard_impl_t impl)
+{
+    switch (impl)
+    {
+    case ZCURVE:
+    case ZCURVE_MULTITHREADED:
+        return z_curve_range;
+    case ZCURVE_MAGIC:
+        return z_curve_magic_range;
+    case ZCURVE_MAGIC_SIMD:
+        return z_curve_simd_magic_range;
+    default:
+        return NULL;
+    }
+}
+
+// the outputs of -s and -o as sinks, for the modes that save while generating
+static inline unsigned standard_sinks(const config_t *cfg, svg_sink_t *svg, curve_file_writer_t *writer, curve_sink_t *sinks)
+{
+    unsigned num_sinks = 0;
+
+    if (cfg->save_svg)
+    {
+        svg_sink_init(svg, &sinks[num_sinks++], 2, 10, cfg->svg_filename);
+    }
+
+    if (cfg->save_curve)
+    {
+        curve_file_sink_init(writer, &sinks[num_sinks++], LAYOUT_SOA, cfg->curve_filename);
+    }
+
+    return num_sinks;
+}
+
+static inline void end_standard_sinks(const curve_sink_t *sinks, unsigned num_sinks, int *result)
+{
+    for (unsigned i = 0; i < num_sinks; ++i)
+    {
+        if (sinks[i].end(sinks[i].ctx))
+        {
+            *result = -1;
+        }
+    }
+}
+
+static inline int run_pipelined(const config_t *cfg)
+{
+    block_kernel_t kernel = pipeline_kernel(cfg->implementation);
+    if (kernel == NULL)
+    {
+        fprintf(stderr, "%s: implementation %s does not support pipelined mode\n", get_filename(cfg->path), impl_to_string(cfg->implementation, cfg->mode));
+        return -1;
+    }
+
+    printf("Generating and saving zcurve...\n");
+
+    svg_sink_t svg;
+    curve_file_writer_t writer;
+    curve_sink_t sinks[2];
+    unsigned num_sinks = standard_sinks(cfg, &svg, &writer, sinks);
+
+    if (z_curve_pipeline(cfg->degree, kernel, cfg->num_threads, sinks, num_sinks))
+    {
+        fprintf(stderr, "%s: failed to run pipeline\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    printf("Done!\n");
+
+    return 0;
+}
+
+// -n: the curve file with 8 bit coordinates, whichever kernel generated the curve
+static inline int write_narrow_curve(const config_t *cfg, const coord_t *x, const coord_t *y)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+
+    bench_buffers_t buffers = {0};
+    coord8_t *x8 = (coord8_t *)bench_alloc(&buffers, sizeof(coord8_t) * max);
+    coord8_t *y8 = (coord8_t *)bench_alloc(&buffers, sizeof(coord8_t) * max);
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        return -1;
+    }
+
+    for (size_t i = 0; i < max; ++i)
+    {
+        x8[i] = (coord8_t)x[i];
+        y8[i] = (coord8_t)y[i];
+    }
+
+    int result = z_curve_file_write_8bit(cfg->degree, x8, y8, LAYOUT_SOA, cfg->curve_filename);
+
+    bench_free(&buffers);
+
+    return result;
+}
+
+static inline int save_standard(const config_t *cfg, const coord_t *x, const coord_t *y)
+{
+    if (cfg->save_svg)
+    {
+        printf("Saving data to svg...\n");
+        generate_svg_path(cfg->degree, x, y, 2, 10, cfg->svg_filename, cfg->num_threads);
+        printf("Done!\n");
+    }
+
+    if (cfg->save_curve)
+    {
+        printf("Saving data to curve file...\n");
+        if (cfg->narrow_curve ? write_narrow_curve(cfg, x, y) : z_curve_file_write(cfg->degree, x, y, LAYOUT_SOA, cfg->curve_filename))
+        {
+            fprintf(stderr, "%s: failed to write %s\n", get_filename(cfg->path), cfg->curve_filename);
+            return -1;
+        }
+        printf("Done!\n");
+    }
+
+    if (cfg->save_packed)
+    {
+        printf("Saving data to compressed file...\n");
+
+        packed_curve_t packed;
+        if (z_curve_packed_encode(&packed, cfg->degree, x, y))
+        {
+            fprintf(stderr, "%s: failed to compress zcurve\n", get_filename(cfg->path));
+            return -1;
+        }
+
+        int result = z_curve_packed_write(&packed, cfg->packed_filename);
+        z_curve_packed_free(&packed);
+
+        if (result)
+        {
+            fprintf(stderr, "%s: failed to write %s\n", get_filename(cfg->path), cfg->packed_filename);
+            return -1;
+        }
+        printf("Done!\n");
+    }
+
+    if (cfg->save_raster)
+    {
+        unsigned level = raster_level_of_detail(cfg->degree, RASTER_SIZE);
+        printf("Saving data to image at level of detail %u...\n", level);
+        if (generate_raster(cfg->degree, x, y, RASTER_SIZE, cfg->raster_filename, cfg->num_threads))
+        {
+            return -1;
+        }
+        printf("Done!\n");
+    }
+
+    return 0;
+}
+
+static inline int run_layout(const config_t *cfg)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+    point_t *points = (point_t *)z_curve_alloc(sizeof(point_t) * max);
+    if (points == NULL)
+    {
+        fprintf(stderr, "%s: error in run_layout: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    run_layout_impl(cfg, points);
+
+    printf("Finished generating zcurve in layout %s!\n", output_layout_to_string(cfg->layout));
+
+    int result = 0;
+
+    if (cfg->save_curve)
+    {
+        printf("Saving data to curve file...\n");
+        result = z_curve_file_write_points(cfg->degree, points, cfg->curve_filename);
+        if (result)
+        {
+            fprintf(stderr, "%s: failed to write %s\n", get_filename(cfg->path), cfg->curve_filename);
+        }
+        else
+        {
+            printf("Done!\n");
+        }
+    }
+
+    z_curve_free(points, sizeof(point_t) * max);
+
+    return result;
+}
+
+static inline int run_8bit(const config_t *cfg, const char *kernel)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+    coord8_t *x = (coord8_t *)z_curve_alloc(sizeof(coord8_t) * max);
+    coord8_t *y = (coord8_t *)z_curve_alloc(sizeof(coord8_t) * max);
+    if (x == NULL || y == NULL)
+    {
+        z_curve_free(x, sizeof(coord8_t) * max);
+        z_curve_free(y, sizeof(coord8_t) * max);
+        fprintf(stderr, "%s: error in run_8bit: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    run_8bit_impl(cfg, x, y);
+
+    printf("Finished generating zcurve with 8-bit coordinates!\n");
+
+    int result = 0;
+
+    if (cfg->save_svg)
+    {
+        printf("Saving data to svg...\n");
+        generate_svg_path_8bit(cfg->degree, x, y, 2, 10, cfg->svg_filename, cfg->num_threads);
+        printf("Done!\n");
+    }
+
+    // -o stores coord_t like every other kernel, unless -n asks for 8 bit coordinates
+    if (cfg->save_curve && cfg->narrow_curve)
+    {
+        printf("Saving data to curve file...\n");
+        if (z_curve_file_write_8bit(cfg->degree, x, y, LAYOUT_SOA, cfg->curve_filename))
+        {
+            fprintf(stderr, "%s: failed to write %s\n", get_filename(cfg->path), cfg->curve_filename);
+            result = -1;
+        }
+        else
+        {
+            printf("Done!\n");
+        }
+    }
+
+    // the cache, the raster image, the compressed format and the default curve file take full width coordinates
+    if (!result && (cfg->cache_dir != NULL || cfg->save_raster || cfg->save_packed || (cfg->save_curve && !cfg->narrow_curve)))
+    {
+        coord_t *wide_x = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+        coord_t *wide_y = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+
+        if (wide_x == NULL || wide_y == NULL)
+        {
+            fprintf(stderr, "%s: error in run_8bit: failed to allocate memory\n", get_filename(cfg->path));
+            result = -1;
+        }
+        else
+        {
+            z_curve_widen_8bit(x, wide_x, max);
+            z_curve_widen_8bit(y, wide_y, max);
+
+            if (cfg->cache_dir != NULL && z_curve_cache_store(cfg->cache_dir, cfg->degree, kernel, wide_x, wide_y))
+            {
+                fprintf(stderr, "%s: warning: could not store zcurve in cache %s\n", get_filename(cfg->path), cfg->cache_dir);
+            }
+
+            config_t wide_cfg = *cfg;
+            wide_cfg.save_svg = false;
+            wide_cfg.save_curve = cfg->save_curve && !cfg->narrow_curve;
+            result = save_standard(&wide_cfg, wide_x, wide_y);
+        }
+
+        z_curve_free(wide_x, sizeof(coord_t) * max);
+        z_curve_free(wide_y, sizeof(coord_t) * max);
+    }
+
+    z_curve_free(x, sizeof(coord8_t) * max);
+    z_curve_free(y, sizeof(coord8_t) * max);
+
+    return result;
+}
+
+static inline const char *async_status_to_string(async_status_t status)
+{
+    switch (status)
+    {
+    case ASYNC_RUNNING:
+        return "running";
+    case ASYNC_DONE:
+        return "done";
+    case ASYNC_CANCELLED:
+        return "cancelled";
+    case ASYNC_FAILED:
+        return "failed";
+    default:
+        return "unknown";
+    }
+}
+
+// points [begin, end) to every sink
+static inline int write_sinks(const curve_sink_t *sinks, unsigned num_sinks, const coord_t *x, const coord_t *y, size_t begin, size_t end)
+{
+    for (unsigned i = 0; i < num_sinks; ++i)
+    {
+        if (sinks[i].write(sinks[i].ctx, x + begin, y + begin, begin, end - begin))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+-A: the curve is generated by z_curve_generate_async while this thread
+reports progress and saves every point as soon as it is final. With a
+number of points only those are saved and the rest is cancelled
+*/
+static inline int run_async(const config_t *cfg)
+{
+    size_t max = 1ull << (cfg->degree * 2);
+    size_t limit = cfg->async_points ? cfg->async_points : max;
+
+    bench_buffers_t buffers = {0};
+    coord_t *x = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * max);
+    coord_t *y = (coord_t *)bench_alloc(&buffers, sizeof(coord_t) * max);
+    if (buffers.failed)
+    {
+        bench_free(&buffers);
+        fprintf(stderr, "%s: error in run_async: failed to allocate memory\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    svg_sink_t svg;
+    curve_file_writer_t writer;
+    curve_sink_t sinks[2];
+    unsigned num_sinks = standard_sinks(cfg, &svg, &writer, sinks);
+
+    for (unsigned i = 0; i < num_sinks; ++i)
+    {
+        if (sinks[i].begin(sinks[i].ctx, cfg->degree))
+        {
+            int result = -1;
+            end_standard_sinks(sinks, i, &result);
+            bench_free(&buffers);
+            return result;
+        }
+    }
+
+    z_curve_async_t *handle = z_curve_generate_async(cfg->degree, x, y, cfg->num_threads);
+    if (handle == NULL)
+    {
+        int result = -1;
+        end_standard_sinks(sinks, num_sinks, &result);
+        bench_free(&buffers);
+        fprintf(stderr, "%s: failed to start background generation\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    printf("Generating and saving zcurve in the background...\n");
+
+    const struct timespec pause = {.tv_sec = 0, .tv_nsec = 100000};
+    size_t saved = 0, progress = 0, prefix = 0, report = limit / 4;
+    async_status_t status;
+    int result = 0;
+
+    do
+    {
+        status = z_curve_async_poll(handle, &progress, &prefix);
+        prefix = prefix < limit ? prefix : limit;
+
+        if (prefix == saved)
+        {
+            nanosleep(&pause, NULL);
+            continue;
+        }
+
+        if (write_sinks(sinks, num_sinks, x, y, saved, prefix))
+        {
+            result = -1;
+            break;
+        }
+
+        saved = prefix;
+
+        if (saved >= report && saved < limit)
+        {
+            printf("Generated %zu points, saved %zu of %zu\n", progress, saved, limit);
+            report = saved + limit / 4;
+        }
+    } while (status == ASYNC_RUNNING && saved < limit);
+
+    if (status == ASYNC_RUNNING)
+    {
+        // the rest is not wanted, destroying the handle waits for the workers to stop
+        z_curve_async_cancel(handle);
+    }
+    else
+    {
+        status = z_curve_async_wait(handle);
+    }
+    z_curve_async_destroy(handle);
+
+    if (!result && saved < limit)
+    {
+        if (status != ASYNC_DONE)
+        {
+            fprintf(stderr, "%s: background generation ended %s\n", get_filename(cfg->path), async_status_to_string(status));
+            result = -1;
+        }
+        else
+        {
+            result = write_sinks(sinks, num_sinks, x, y, saved, limit);
+        }
+    }
+
+    end_standard_sinks(sinks, num_sinks, &result);
+    bench_free(&buffers);
+
+    if (!result)
+    {
+        printf("Done, saved %zu of %zu points!\n", limit, max);
+    }
+
+    return result;
+}
+
+static inline int run_standard(const config_t *cfg)
+{
+    if (cfg->pipelined)
+    {
+        return run_pipelined(cfg);
+    }
+
+    if (cfg->async)
+    {
+        return run_async(cfg);
+    }
+
+    // the cache only holds separate arrays
+    if (cfg->layout != OUTPUT_SOA)
+    {
+        return run_layout(cfg);
+    }
+
+    const char *kernel = impl_to_string(cfg->implementation, cfg->mode);
+
+    if (cfg->cache_dir != NULL)
+    {
+        curve_file_t file;
+        if (z_curve_cache_load(cfg->cache_dir, cfg->degree, kernel, &file) == 0)
+        {
+            printf("Loaded zcurve from cache!\n");
+
+            int result = save_standard(cfg, file.x, file.y);
+            z_curve_file_close(&file);
+
+            return result;
+        }
+    }
+
+    if (use_8bit(cfg) && !cfg->extend_from)
+    {
+        return run_8bit(cfg, kernel);
+    }
+
+    size_t max = 1ull << (cfg->degree * 2);
+    coord_t *x = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    if (x == NULL)
+    {
+        fprintf(stderr, "%s: error in run_standard: failed to allocate memory for x\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    coord_t *y = (coord_t *)z_curve_alloc(sizeof(coord_t) * max);
+    if (y == NULL)
+    {
+        z_curve_free(x, sizeof(coord_t) * max);
+        fprintf(stderr, "%s: error in run_standard: failed to allocate memory for y\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    if (cfg->extend_from ? run_extend_impl(cfg, x, y) : run_standard_impl(cfg, x, y, NULL))
+    {
+        z_curve_free(x, sizeof(coord_t) * max);
+        z_curve_free(y, sizeof(coord_t) * max);
+        return -1;
+    }
+
+    printf("Finished generating zcurve!\n");
+
+    // a failing cache must never fail the run, the next call just generates again
+    if (cfg->cache_dir != NULL && z_curve_cache_store(cfg->cache_dir, cfg->degree, kernel, x, y))
+    {
+        fprintf(stderr, "%s: warning: could not store zcurve in cache %s\n", get_filename(cfg->path), cfg->cache_dir);
+    }
+
+    int result = save_standard(cfg, x, y);
+
+    z_curve_free(x, sizeof(coord_t) * max);
+    z_curve_free(y, sizeof(coord_t) * max);
+
+    return result;
+}
+
+static inline int run_benchmark(const config_t *cfg)
+{
+    switch (cfg->mode)
+    {
+    case STANDARD:
+        printf("Running implementation: %s\n", impl_to_string(cfg->implementation, cfg->mode));
+        return benchmark_standard(cfg);
+    case INDEX:
+        return benchmark_index(cfg);
+    case POSITION:
+        return cfg->batch_count ? run_position_batch(cfg) : benchmark_position(cfg);
+    case TABLES:
+        return benchmark_tables(cfg) || benchmark_batch_decoders(cfg) ? -1 : 0;
+    case VIEW:
+        return benchmark_view(cfg);
+    case GRID:
+        return benchmark_grid(cfg);
+    case PYRAMID:
+        return benchmark_pyramid(cfg);
+    case SORT:
+        return benchmark_sort(cfg);
+    case QUADTREE:
+        return benchmark_quadtree(cfg);
+    case JOIN:
+        return benchmark_join(cfg);
+    case BATCH:
+        return run_batch(cfg);
+    default:
+        fprintf(stderr, "%s: argument error: invalid mode\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    return 0;
+}
+
+static inline int run_default(const config_t *cfg)
+{
+    switch (cfg->mode)
+    {
+    case STANDARD:
+        printf("You have chosen version: %s\n", impl_to_string(cfg->implementation, cfg->mode));
+        return run_standard(cfg);
+    case INDEX:
+        return run_index(cfg);
+    case POSITION:
+        return cfg->batch_count ? run_position_batch(cfg) : run_position(cfg);
+    case GRID:
+        return run_grid(cfg);
+    case BATCH:
+        return run_batch(cfg);
+    default:
+        fprintf(stderr, "%s: argument error: invalid mode\n", get_filename(cfg->path));
+        return -1;
+    }
+
+    return 0;
+}
+
+void print_help(const char *path)
+{
+    const char *program_name = get_filename(path);
+    printf(USAGE, program_name);
+    fputs(USAGE_MODES, stdout);
+    printf(USAGE_EXAMPLES, program_name, program_name, program_name, program_name);
+}
+
+void print_available_implementations_for_mode(mode_of_operation_t mode)
+{
+    switch (mode)
+    {
+    case STANDARD:
+        for (int i = 0; i < MAX_IMPL; i++)
+        {
+            printf("\t%s : %d\n", standard_impl_to_string((standard_impl_t)i), i);
+        }
+        break;
+    case INDEX:
+        for (int i = 0; i < INDEX_MAX_IMPL; i++)
+        {
+            printf("\t%s : %d\n", index_impl_to_string((index_impl_t)i), i);
+        }
+        break;
+    case POSITION:
+        for (int i = 0; i < POSITION_MAX_IMPL; i++)
+        {
+            printf("\t%s : %d\n", position_impl_to_string((position_impl_t)i), i);
+        }
+        break;
+    case BATCH:
+        for (int i = 0; i < BATCH_MAX_IMPL; i++)
+        {
+            printf("\t%s : %d\n", batch_impl_to_string((batch_impl_t)i), i);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void print_available_implementations()
+{
+    static const mode_of_operation_t modes[] = {STANDARD, INDEX, POSITION, BATCH};
+
     printf("Available implementations:\n");
-    for (int i = 0; i < 3; i++)
+    for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++)
     {
-        printf("Mode: %s\n", mode_to_string((mode_of_operation_t)i));
-        print_available_implementations_for_mode((mode_of_operation_t)i);
+        printf("Mode: %s\n", mode_to_string(modes[i]));
+        print_available_implementations_for_mode(modes[i]);
     }
 }
 
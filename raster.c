@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "raster.h"
+#include "zcurve_scheduler.h"
+
+typedef struct
+{
+    const coord_t *x;
+    const coord_t *y;
+    size_t num_points;
+    unsigned index_shift;
+    unsigned coord_shift;
+    unsigned size;
+    unsigned cell;
+    unsigned char *pixels;
+} raster_t;
+
+unsigned raster_level_of_detail(unsigned degree, unsigned size)
+{
+    // the finest curve where every cell is still at least 2 pixels wide,
+    // otherwise neighbouring segments merge into a solid area
+    unsigned level = 0;
+    while ((2u << (level + 1)) <= size)
+    {
+        ++level;
+    }
+
+    return degree < level ? degree : level;
+}
+
+// colour code the position along the curve: red at the start, blue at the end
+static inline void index_to_rgb(size_t i, size_t max, unsigned char *rgb)
+{
+    unsigned hue = (unsigned)((i * 1200) / max);
+    unsigned sector = hue / 300;
+    unsigned char f = (unsigned char)(((hue % 300) * 230) / 300);
+    unsigned char q = 230 - f;
+
+    switch (sector)
+    {
+    case 0:
+        rgb[0] = 230, rgb[1] = f, rgb[2] = 0;
+        break;
+    case 1:
+        rgb[0] = q, rgb[1] = 230, rgb[2] = 0;
+        break;
+    case 2:
+        rgb[0] = 0, rgb[1] = 230, rgb[2] = f;
+        break;
+    default:
+        rgb[0] = 0, rgb[1] = q, rgb[2] = 230;
+        break;
+    }
+}
+
+// bresenham, restricted to the rows [row_begin, row_end) of the stripe we own
+static void draw_segment(const raster_t *raster, int x0, int y0, int x1, int y1, const unsigned char *rgb, int row_begin, int row_end)
+{
+    if ((y0 < row_begin && y1 < row_begin) || (y0 >= row_end && y1 >= row_end))
+    {
+        return;
+    }
+
+    int dx = abs(x1 - x0);
+    int dy = -abs(y1 - y0);
+    int sx = x0 < x1 ? 1 : -1;
+    int sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    for (;;)
+    {
+        if (y0 >= row_begin && y0 < row_end)
+        {
+            memcpy(&raster->pixels[((size_t)y0 * raster->size + x0) * 3], rgb, 3);
+        }
+
+        if (x0 == x1 && y0 == y1)
+        {
+            break;
+        }
+
+        int e2 = 2 * err;
+        if (e2 >= dy)
+        {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx)
+        {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+static void render_stripe(size_t row_begin, size_t row_end, void *arg)
+{
+    const raster_t *raster = (const raster_t *)arg;
+
+    memset(&raster->pixels[row_begin * raster->size * 3], 0xff, (row_end - row_begin) * raster->size * 3);
+
+    unsigned half = raster->cell >> 1;
+
+    // only every (4^shift)-th point is drawn, which is exactly the coarser curve scaled up
+    int px = (raster->x[0] >> raster->coord_shift) * raster->cell + half;
+    int py = (raster->y[0] >> raster->coord_shift) * raster->cell + half;
+
+    for (size_t j = 1; j < raster->num_points; ++j)
+    {
+        size_t i = j << raster->index_shift;
+
+        int nx = (raster->x[i] >> raster->coord_shift) * raster->cell + half;
+        int ny = (raster->y[i] >> raster->coord_shift) * raster->cell + half;
+
+        unsigned char rgb[3];
+        index_to_rgb(j, raster->num_points, rgb);
+
+        draw_segment(raster, px, py, nx, ny, rgb, (int)row_begin, (int)row_end);
+
+        px = nx;
+        py = ny;
+    }
+}
+
+int generate_raster(unsigned degree, const coord_t *x, const coord_t *y, unsigned size, char *filename, unsigned num_threads)
+{
+    unsigned level = raster_level_of_detail(degree, size);
+
+    raster_t raster;
+    raster.x = x;
+    raster.y = y;
+    raster.num_points = 1ull << (level * 2);
+    raster.coord_shift = degree - level;
+    raster.index_shift = (degree - level) * 2;
+    raster.size = size;
+    raster.cell = size >> level;
+    raster.pixels = malloc((size_t)size * size * 3);
+
+    if (raster.pixels == NULL)
+    {
+        fprintf(stderr, "Failed to allocate memory for the image!\n");
+        return -1;
+    }
+
+    scheduler_t scheduler;
+    int result = parallel_for_chunks(&scheduler, size, RASTER_STRIPE_ROWS, num_threads, render_stripe, &raster);
+    scheduler_destroy(&scheduler);
+
+    if (result)
+    {
+        free(raster.pixels);
+        return -1;
+    }
+
+    // binary ppm, the colour sibling of pgm
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open %s!\n", filename);
+        free(raster.pixels);
+        return -1;
+    }
+
+    fprintf(fp, "P6\n%u %u\n255\n", size, size);
+    fwrite(raster.pixels, 3, (size_t)size * size, fp);
+
+    if (ferror(fp))
+    {
+        result = -1;
+    }
+
+    if (fclose(fp))
+    {
+        result = -1;
+    }
+
+    free(raster.pixels);
+
+    return result;
+}
@@ -0,0 +1,14 @@
+#ifndef _RASTER_H
+#define _RASTER_H
+
+#include "zcurve.h"
+
+#define RASTER_SIZE 1024
+
+// rows each thread renders at a time
+#define RASTER_STRIPE_ROWS 32
+
+unsigned raster_level_of_detail(unsigned degree, unsigned size);
+int generate_raster(unsigned degree, const coord_t *x, const coord_t *y, unsigned size, char *filename, unsigned num_threads);
+
+#endif // _RASTER_H
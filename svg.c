@@ -1,8 +1,14 @@
+#define _POSIX_C_SOURCE 200809L
 #include "svg.h"
 #include "zcurve.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #define SVG_HEAD "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"            \
                  "<svg width=\"%zu\" height=\"%zu\" xmlns=\"http://www.w3.org/2000/svg\">\n" \
@@ -11,65 +17,575 @@
 #define SVG_TAIL "</g>\n" \
                  "</svg>\n"
 
-void generate_svg_line(unsigned degree, coord_t *x, coord_t *y, unsigned offset, unsigned scale, char *filename)
+#define SVG_RECT "<rect x=\"0\" y=\"0\" width=\"100%%\" height=\"100%%\" fill=\"none\" stroke=\"black\" stroke-width=\"%f\"/>\n"
+
+#define SVG_PATH_TAIL "\" fill=\"none\" stroke=\"black\" stroke-width=\"%f\"/>\n"
+
+// longest header or tail we ever format with snprintf
+#define SVG_FRAME_MAX_LENGTH 512
+
+// longest "<line .../>" element, four 10 digit coordinates plus the stroke attributes
+#define SVG_LINE_ELEMENT_MAX_LENGTH (80 + SVG_FRAME_MAX_LENGTH)
+
+static const char digit_pairs[201] = "00010203040506070809"
+                                     "10111213141516171819"
+                                     "20212223242526272829"
+                                     "30313233343536373839"
+                                     "40414243444546474849"
+                                     "50515253545556575859"
+                                     "60616263646566676869"
+                                     "70717273747576777879"
+                                     "80818283848586878889"
+                                     "90919293949596979899";
+
+// same output as printf("%u"), two digits per division
+static inline char *format_uint(char *p, unsigned value)
+{
+    char digits[10];
+    char *end = digits + sizeof(digits);
+    char *d = end;
+
+    while (value >= 100)
+    {
+        unsigned pair = (value % 100) << 1;
+        value /= 100;
+        *--d = digit_pairs[pair + 1];
+        *--d = digit_pairs[pair];
+    }
+
+    if (value >= 10)
+    {
+        unsigned pair = value << 1;
+        *--d = digit_pairs[pair + 1];
+        *--d = digit_pairs[pair];
+    }
+    else
+    {
+        *--d = (char)('0' + value);
+    }
+
+    size_t length = end - d;
+    memcpy(p, d, length);
+
+    return p + length;
+}
+
+// formats "L%u,%u " for every point, the buffer needs SVG_PATH_ELEMENT_MAX_LENGTH bytes per point
+static size_t format_path_points(char *buffer, const coord_t *x, const coord_t *y, size_t count, unsigned offset, unsigned scale)
+{
+    char *p = buffer;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        *p++ = 'L';
+        p = format_uint(p, (x[i] + offset) * scale);
+        *p++ = ',';
+        p = format_uint(p, (y[i] + offset) * scale);
+        *p++ = ' ';
+    }
+
+    return p - buffer;
+}
+
+// same for 8 bit coordinates
+static size_t format_path_points_8bit(char *buffer, const coord8_t *x, const coord8_t *y, size_t count, unsigned offset, unsigned scale)
+{
+    char *p = buffer;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        *p++ = 'L';
+        p = format_uint(p, (x[i] + offset) * scale);
+        *p++ = ',';
+        p = format_uint(p, (y[i] + offset) * scale);
+        *p++ = ' ';
+    }
+
+    return p - buffer;
+}
+
+typedef struct
+{
+    const coord_t *x;
+    const coord_t *y;
+    const coord8_t *x8;
+    const coord8_t *y8;
+    unsigned offset;
+    unsigned scale;
+    const char *stroke;
+    size_t stroke_length;
+} svg_format_t;
+
+typedef size_t (*svg_format_fn_t)(char *buffer, size_t first, size_t count, const svg_format_t *format);
+
+static size_t format_path_chunk(char *buffer, size_t first, size_t count, const svg_format_t *format)
+{
+    return format_path_points(buffer, &format->x[first], &format->y[first], count, format->offset, format->scale);
+}
+
+static size_t format_path_chunk_8bit(char *buffer, size_t first, size_t count, const svg_format_t *format)
+{
+    return format_path_points_8bit(buffer, &format->x8[first], &format->y8[first], count, format->offset, format->scale);
+}
+
+static size_t format_line_chunk(char *buffer, size_t first, size_t count, const svg_format_t *format)
+{
+    const coord_t *x = format->x;
+    const coord_t *y = format->y;
+    unsigned offset = format->offset;
+    unsigned scale = format->scale;
+
+    char *p = buffer;
+
+    for (size_t i = first; i < first + count; ++i)
+    {
+        memcpy(p, "<line x1=\"", 10);
+        p = format_uint(p + 10, (x[i] + offset) * scale);
+        memcpy(p, "\" y1=\"", 6);
+        p = format_uint(p + 6, (y[i] + offset) * scale);
+        memcpy(p, "\" x2=\"", 6);
+        p = format_uint(p + 6, (x[(i + 1)] + offset) * scale);
+        memcpy(p, "\" y2=\"", 6);
+        p = format_uint(p + 6, (y[(i + 1)] + offset) * scale);
+
+        // the stroke attributes are the same for every line, format them once
+        memcpy(p, format->stroke, format->stroke_length);
+        p += format->stroke_length;
+    }
+
+    return p - buffer;
+}
+
+static int write_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0)
+    {
+        ssize_t written = writev(fd, iov, iovcnt);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        // skip what made it out, a short write may stop in the middle of a chunk
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len)
+        {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+
+        if (iovcnt > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return 0;
+}
+
+typedef struct
+{
+    const svg_format_t *format;
+    svg_format_fn_t format_fn;
+    size_t first;
+    size_t count;
+    size_t chunk_items;
+    unsigned num_threads;
+    char **buffers;
+    struct iovec *iov;
+    pthread_barrier_t formatted;
+    pthread_barrier_t written;
+    pthread_mutex_t lock;
+    pthread_cond_t started;
+    int running;
+    int fd;
+    int error;
+} svg_writer_t;
+
+typedef struct
+{
+    svg_writer_t *writer;
+    unsigned thread_id;
+} svg_writer_arg_t;
+
+/*
+every round each thread formats one chunk into its own buffer, then the
+first thread stitches the chunks together in order with one writev while
+the others wait for the next round
+*/
+static void *svg_writer_thread(void *arg)
+{
+    svg_writer_arg_t *writer_arg = (svg_writer_arg_t *)arg;
+    svg_writer_t *writer = writer_arg->writer;
+    unsigned t = writer_arg->thread_id;
+
+    // the number of threads is only known once every thread was created
+    pthread_mutex_lock(&writer->lock);
+    while (!writer->running)
+    {
+        pthread_cond_wait(&writer->started, &writer->lock);
+    }
+    pthread_mutex_unlock(&writer->lock);
+
+    size_t round_items = writer->chunk_items * writer->num_threads;
+
+    for (size_t round = 0; round < writer->count; round += round_items)
+    {
+        size_t start = round + writer->chunk_items * t;
+        size_t length = 0;
+
+        if (start < writer->count)
+        {
+            size_t count = writer->count - start < writer->chunk_items ? writer->count - start : writer->chunk_items;
+            length = writer->format_fn(writer->buffers[t], writer->first + start, count, writer->format);
+        }
+
+        writer->iov[t].iov_base = writer->buffers[t];
+        writer->iov[t].iov_len = length;
+
+        pthread_barrier_wait(&writer->formatted);
+
+        if (t == 0 && !writer->error && write_all(writer->fd, writer->iov, writer->num_threads))
+        {
+            writer->error = 1;
+        }
+
+        pthread_barrier_wait(&writer->written);
+
+        if (writer->error)
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int write_items(int fd, const svg_format_t *format, svg_format_fn_t format_fn, size_t first, size_t count, size_t item_length, unsigned num_threads)
+{
+    if (num_threads < 1)
+    {
+        num_threads = 1;
+    }
+
+    svg_writer_t writer;
+    writer.format = format;
+    writer.format_fn = format_fn;
+    writer.first = first;
+    writer.count = count;
+    writer.chunk_items = SVG_CHUNK_ITEMS;
+    writer.num_threads = num_threads;
+    writer.fd = fd;
+    writer.error = 0;
+
+    if (count < writer.chunk_items * num_threads)
+    {
+        // small curves: split evenly instead of leaving threads idle
+        writer.chunk_items = (count + num_threads - 1) / num_threads;
+        if (writer.chunk_items == 0)
+        {
+            return 0;
+        }
+    }
+
+    writer.buffers = calloc(num_threads, sizeof(char *));
+    writer.iov = malloc(sizeof(struct iovec) * num_threads);
+    svg_writer_arg_t *args = malloc(sizeof(svg_writer_arg_t) * num_threads);
+    pthread_t *threads = malloc(sizeof(pthread_t) * num_threads);
+
+    int result = -1;
+
+    if (writer.buffers == NULL || writer.iov == NULL || args == NULL || threads == NULL)
+    {
+        goto cleanup;
+    }
+
+    for (unsigned t = 0; t < num_threads; ++t)
+    {
+        writer.buffers[t] = malloc(item_length * writer.chunk_items);
+        if (writer.buffers[t] == NULL)
+        {
+            goto cleanup;
+        }
+
+        args[t].writer = &writer;
+        args[t].thread_id = t;
+    }
+
+    pthread_mutex_init(&writer.lock, NULL);
+    pthread_cond_init(&writer.started, NULL);
+    writer.running = 0;
+
+    unsigned started = 1;
+    for (unsigned t = 1; t < num_threads; ++t)
+    {
+        // threads that fail to start are left out, the chunks are spread over the others
+        if (pthread_create(&threads[started], NULL, svg_writer_thread, &args[started]) == 0)
+        {
+            ++started;
+        }
+    }
+
+    writer.num_threads = started;
+    pthread_barrier_init(&writer.formatted, NULL, started);
+    pthread_barrier_init(&writer.written, NULL, started);
+
+    pthread_mutex_lock(&writer.lock);
+    writer.running = 1;
+    pthread_cond_broadcast(&writer.started);
+    pthread_mutex_unlock(&writer.lock);
+
+    // the calling thread takes part as thread 0
+    svg_writer_thread(&args[0]);
+
+    for (unsigned t = 1; t < started; ++t)
+    {
+        pthread_join(threads[t], NULL);
+    }
+
+    pthread_barrier_destroy(&writer.formatted);
+    pthread_barrier_destroy(&writer.written);
+    pthread_mutex_destroy(&writer.lock);
+    pthread_cond_destroy(&writer.started);
+
+    result = writer.error ? -1 : 0;
+
+cleanup:
+    if (writer.buffers != NULL)
+    {
+        for (unsigned t = 0; t < num_threads; ++t)
+        {
+            free(writer.buffers[t]);
+        }
+    }
+
+    free(writer.buffers);
+    free(writer.iov);
+    free(args);
+    free(threads);
+
+    return result;
+}
+
+static int write_string(int fd, const char *string, size_t length)
+{
+    struct iovec iov = {.iov_base = (void *)string, .iov_len = length};
+    return write_all(fd, &iov, 1);
+}
+
+static int open_svg(const char *filename)
+{
+    // create an svg file to visualize the z curve
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0)
+    {
+        fprintf(stderr, "Failed to open %s!\n", filename);
+    }
+
+    return fd;
+}
+
+void generate_svg_line(unsigned degree, const coord_t *x, const coord_t *y, unsigned offset, unsigned scale, char *filename, unsigned num_threads)
 {
     size_t size = 1ull << degree;
     size_t max = 1ull << (degree * 2);
     size_t dim = (size - 1 + offset * 2) * scale;
 
-    // create an svg file to visualize the z curve
-    FILE *fp = fopen(filename, "w");
-    if (fp == NULL)
+    int fd = open_svg(filename);
+    if (fd < 0)
     {
-        fprintf(stderr, "Failed to open %s!\n", filename);
         return;
     }
 
-    fprintf(fp, SVG_HEAD, dim, dim);
+    char head[SVG_FRAME_MAX_LENGTH];
+    int head_length = snprintf(head, sizeof(head), SVG_HEAD, dim, dim);
+
+    char stroke[SVG_FRAME_MAX_LENGTH];
+    int stroke_length = snprintf(stroke, sizeof(stroke), "\" stroke=\"black\" stroke-width=\"%f\"/>\n", 0.1 * scale);
+
+    svg_format_t format = {.x = x, .y = y, .offset = offset, .scale = scale, .stroke = stroke, .stroke_length = stroke_length};
+
+    int result = write_string(fd, head, head_length);
 
     // draw lines between the points
-    for (size_t i = 0; i < max - 1; ++i)
+    if (!result)
     {
-        fprintf(fp, "<line x1=\"%u\" y1=\"%u\" x2=\"%u\" y2=\"%u\" stroke=\"black\" stroke-width=\"%f\"/>\n", (x[i] + offset) * scale, (y[i] + offset) * scale, (x[(i + 1)] + offset) * scale, (y[(i + 1)] + offset) * scale, 0.1 * scale);
+        result = write_items(fd, &format, format_line_chunk, 0, max - 1, SVG_LINE_ELEMENT_MAX_LENGTH, num_threads);
     }
 
-    fprintf(fp, SVG_TAIL);
+    if (!result)
+    {
+        result = write_string(fd, SVG_TAIL, strlen(SVG_TAIL));
+    }
 
-    fclose(fp);
+    if (close(fd) || result)
+    {
+        fprintf(stderr, "Failed to write %s!\n", filename);
+    }
 
     return;
 }
 
-void generate_svg_path(unsigned degree, coord_t *x, coord_t *y, unsigned offset, unsigned scale, char *filename)
+static int svg_path_begin(void *ctx, unsigned degree)
+{
+    svg_sink_t *svg = (svg_sink_t *)ctx;
+
+    size_t size = 1ull << degree;
+    size_t dim = (size - 1 + svg->offset * 2) * svg->scale;
+
+    // create an svg file to visualize the z curve
+    svg->fp = fopen(svg->filename, "w");
+    if (svg->fp == NULL)
+    {
+        fprintf(stderr, "Failed to open %s!\n", svg->filename);
+        return -1;
+    }
+
+    svg->buffer = malloc(SVG_PATH_ELEMENT_MAX_LENGTH * PIPELINE_BLOCK_POINTS);
+    if (svg->buffer == NULL)
+    {
+        fclose(svg->fp);
+        svg->fp = NULL;
+        return -1;
+    }
+
+    fprintf(svg->fp, SVG_HEAD, dim, dim);
+
+    fprintf(svg->fp, SVG_RECT, 0.1 * svg->scale);
+
+    return 0;
+}
+
+static int svg_path_write(void *ctx, const coord_t *x, const coord_t *y, size_t start, size_t count)
 {
+    svg_sink_t *svg = (svg_sink_t *)ctx;
+    unsigned offset = svg->offset;
+    unsigned scale = svg->scale;
+
+    if (start == 0 && count)
+    {
+        fprintf(svg->fp, "<path d=\"M%u,%u ", (x[0] + offset) * scale, (y[0] + offset) * scale);
+        ++x;
+        ++y;
+        --count;
+    }
+
+    // blocks from the pipeline never exceed PIPELINE_BLOCK_POINTS
+    while (count)
+    {
+        size_t n = count < PIPELINE_BLOCK_POINTS ? count : PIPELINE_BLOCK_POINTS;
+        size_t length = format_path_points(svg->buffer, x, y, n, offset, scale);
+
+        fwrite(svg->buffer, 1, length, svg->fp);
+
+        x += n;
+        y += n;
+        count -= n;
+    }
+
+    return ferror(svg->fp) ? -1 : 0;
+}
+
+static int svg_path_end(void *ctx)
+{
+    svg_sink_t *svg = (svg_sink_t *)ctx;
+
+    if (svg->fp == NULL)
+    {
+        return -1;
+    }
+
+    fprintf(svg->fp, SVG_PATH_TAIL, 0.05 * svg->scale);
+
+    fprintf(svg->fp, SVG_TAIL);
+
+    int result = ferror(svg->fp) ? -1 : 0;
+
+    if (fclose(svg->fp))
+    {
+        result = -1;
+    }
+
+    free(svg->buffer);
+
+    svg->fp = NULL;
+    svg->buffer = NULL;
+
+    return result;
+}
+
+void svg_sink_init(svg_sink_t *svg, curve_sink_t *sink, unsigned offset, unsigned scale, char *filename)
+{
+    svg->fp = NULL;
+    svg->buffer = NULL;
+    svg->filename = filename;
+    svg->offset = offset;
+    svg->scale = scale;
+
+    sink->begin = svg_path_begin;
+    sink->write = svg_path_write;
+    sink->end = svg_path_end;
+    sink->ctx = svg;
+}
+
+static void write_svg_path(unsigned degree, const svg_format_t *format, svg_format_fn_t format_fn, unsigned x0, unsigned y0, char *filename, unsigned num_threads)
+{
+    unsigned offset = format->offset;
+    unsigned scale = format->scale;
+
     size_t size = 1ull << degree;
     size_t max = 1ull << (degree * 2);
     size_t dim = (size - 1 + offset * 2) * scale;
 
-    // create an svg file to visualize the z curve
-    FILE *fp = fopen(filename, "w");
-    if (fp == NULL)
+    int fd = open_svg(filename);
+    if (fd < 0)
     {
-        fprintf(stderr, "Failed to open %s!\n", filename);
         return;
     }
 
-    fprintf(fp, SVG_HEAD, dim, dim);
+    char head[SVG_FRAME_MAX_LENGTH * 2];
+    int head_length = snprintf(head, sizeof(head), SVG_HEAD, dim, dim);
+    head_length += snprintf(head + head_length, sizeof(head) - head_length, SVG_RECT, 0.1 * scale);
+    head_length += snprintf(head + head_length, sizeof(head) - head_length, "<path d=\"M%u,%u ", (x0 + offset) * scale, (y0 + offset) * scale);
 
-    fprintf(fp, "<rect x=\"0\" y=\"0\" width=\"100%%\" height=\"100%%\" fill=\"none\" stroke=\"black\" stroke-width=\"%f\"/>\n", 0.1 * scale);
+    char tail[SVG_FRAME_MAX_LENGTH];
+    int tail_length = snprintf(tail, sizeof(tail), SVG_PATH_TAIL SVG_TAIL, 0.05 * scale);
 
-    fprintf(fp, "<path d=\"M%u,%u ", (x[0] + offset) * scale, (y[0] + offset) * scale);
+    int result = write_string(fd, head, head_length);
 
-    for (size_t i = 1; i < max; ++i)
+    if (!result)
     {
-        fprintf(fp, "L%u,%u ", (x[i] + offset) * scale, (y[i] + offset) * scale);
+        result = write_items(fd, format, format_fn, 1, max - 1, SVG_PATH_ELEMENT_MAX_LENGTH, num_threads);
     }
 
-    fprintf(fp, "\" fill=\"none\" stroke=\"black\" stroke-width=\"%f\"/>\n", 0.05 * scale);
-
-    fprintf(fp, SVG_TAIL);
+    if (!result)
+    {
+        result = write_string(fd, tail, tail_length);
+    }
 
-    fclose(fp);
+    if (close(fd) || result)
+    {
+        fprintf(stderr, "Failed to write %s!\n", filename);
+    }
 
     return;
 }
+
+void generate_svg_path(unsigned degree, const coord_t *x, const coord_t *y, unsigned offset, unsigned scale, char *filename, unsigned num_threads)
+{
+    svg_format_t format = {.x = x, .y = y, .offset = offset, .scale = scale};
+
+    write_svg_path(degree, &format, format_path_chunk, x[0], y[0], filename, num_threads);
+}
+
+void generate_svg_path_8bit(unsigned degree, const coord8_t *x, const coord8_t *y, unsigned offset, unsigned scale, char *filename, unsigned num_threads)
+{
+    svg_format_t format = {.x8 = x, .y8 = y, .offset = offset, .scale = scale};
+
+    write_svg_path(degree, &format, format_path_chunk_8bit, x[0], y[0], filename, num_threads);
+}
@@ -1,11 +1,30 @@
 #ifndef _SVG_H
 #define _SVG_H
 
+#include <stdio.h>
+
 #include "zcurve.h"
+#include "zcurve_pipeline.h"
 
 #define SVG_PATH_ELEMENT_MAX_LENGTH 23
 
-void generate_svg_line(unsigned degree, coord_t *x, coord_t *y, unsigned offset, unsigned scale, char *filename);
-void generate_svg_path(unsigned degree, coord_t *x, coord_t *y, unsigned offset, unsigned scale, char *filename);
+// points each thread formats per round before the chunks are written out
+#define SVG_CHUNK_ITEMS (1ull << 16)
+
+typedef struct
+{
+    FILE *fp;
+    char *buffer;
+    char *filename;
+    unsigned offset;
+    unsigned scale;
+} svg_sink_t;
+
+void generate_svg_line(unsigned degree, const coord_t *x, const coord_t *y, unsigned offset, unsigned scale, char *filename, unsigned num_threads);
+void generate_svg_path(unsigned degree, const coord_t *x, const coord_t *y, unsigned offset, unsigned scale, char *filename, unsigned num_threads);
+void generate_svg_path_8bit(unsigned degree, const coord8_t *x, const coord8_t *y, unsigned offset, unsigned scale, char *filename, unsigned num_threads);
+
+// streams the path element block by block, e.g. from z_curve_pipeline
+void svg_sink_init(svg_sink_t *svg, curve_sink_t *sink, unsigned offset, unsigned scale, char *filename);
 
 #endif // _SVG_H
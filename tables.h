@@ -17,4 +17,8 @@ typedef struct
 #include "lookup_table_8bit.h"
 #include "lookup_table_16bit.h"
 
+#include "lookup_table_encode_4bit.h"
+#include "lookup_table_encode_8bit.h"
+#include "lookup_table_encode_16bit.h"
+
 #endif // _TABLES_H
@@ -1,21 +1,57 @@
 #include "zcurve.h"
 
-void z_curve(unsigned degree, coord_t *x, coord_t *y)
+static inline __attribute__((always_inline)) void z_curve_kernel(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y)
 {
-    // number of max points is 4^degree
-    size_t max = 1ull << (degree * 2);
-
-    for (size_t i = 0; i < max; ++i)
+    for (size_t i = 0; i < count; ++i)
     {
+        size_t idx = start + i;
+
         x[i] = 0;
         y[i] = 0;
 
         for (unsigned j = 0; j < degree; ++j)
         {
-            x[i] |= ((i >> (j * 2)) & 1ull) << j;
-            y[i] |= ((i >> (j * 2 + 1)) & 1ull) << j;
+            x[i] |= ((idx >> (j * 2)) & 1ull) << j;
+            y[i] |= ((idx >> (j * 2 + 1)) & 1ull) << j;
         }
     }
+}
+
+typedef void (*z_curve_kernel_t)(size_t start, size_t count, coord_t *x, coord_t *y);
+
+#define Z_CURVE_KERNEL(d)                                                               \
+    static void z_curve_kernel_d##d(size_t start, size_t count, coord_t *x, coord_t *y) \
+    {                                                                                   \
+        z_curve_kernel(d, start, count, x, y);                                          \
+    }
+FOR_EACH_DEGREE(Z_CURVE_KERNEL)
+#undef Z_CURVE_KERNEL
+
+#define Z_CURVE_KERNEL_ENTRY(d) z_curve_kernel_d##d,
+static const z_curve_kernel_t z_curve_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_KERNEL_ENTRY)};
+#undef Z_CURVE_KERNEL_ENTRY
+
+void z_curve(unsigned degree, coord_t *x, coord_t *y)
+{
+    // number of max points is 4^degree
+    size_t max = 1ull << (degree * 2);
+
+    z_curve_range(degree, 0, max, x, y);
+
+    return;
+}
+
+void z_curve_range(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y)
+{
+    // like z_curve, but only for the points [start, start + count) written to x[0] and y[0] onwards
+    if (degree >= 1 && degree <= DEGREE_MAX)
+    {
+        z_curve_kernels[degree - 1](start, count, x, y);
+    }
+    else
+    {
+        z_curve_kernel(degree, start, count, x, y);
+    }
 
     return;
 }
@@ -4,6 +4,7 @@
 #include "defs.h"
 
 void z_curve(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_range(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y);
 void z_curve_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
 size_t z_curve_pos(unsigned degree, coord_t x, coord_t y);
 
@@ -0,0 +1,199 @@
+#include <immintrin.h>
+
+#include "zcurve_8bit.h"
+#include "zcurve_simd.h"
+#include "zcurve_codec.h"
+
+/*
+16 consecutive points starting at a multiple of 16 form a 4x4 block, so
+one decode of the block corner plus a constant offset pattern gives all
+of them. 32 points are two such blocks side by side.
+The curve is at most 64 KiB per array and never leaves the cache, so
+unaligned stores are used throughout, they cost nothing extra on
+aligned data
+*/
+static const coord8_t offset_x[32] = {0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3,
+                                      4, 5, 4, 5, 6, 7, 6, 7, 4, 5, 4, 5, 6, 7, 6, 7};
+static const coord8_t offset_y[32] = {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3,
+                                      0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3};
+
+void z_curve_magic_8bit(unsigned degree, coord8_t *x, coord8_t *y)
+{
+    size_t max = 1ull << (degree * 2);
+
+    for (size_t i = 0; i < max; ++i)
+    {
+        coord_t cx, cy;
+        decode(i, &cx, &cy);
+        x[i] = (coord8_t)cx;
+        y[i] = (coord8_t)cy;
+    }
+}
+
+static void z_curve_sse_magic_8bit(size_t max, coord8_t *x, coord8_t *y)
+{
+    __m128i pattern_x = _mm_loadu_si128((const __m128i *)offset_x);
+    __m128i pattern_y = _mm_loadu_si128((const __m128i *)offset_y);
+
+    for (size_t i = 0; i < max; i += 16)
+    {
+        coord_t cx, cy;
+        decode(i, &cx, &cy);
+
+        _mm_storeu_si128((__m128i *)&x[i], _mm_add_epi8(_mm_set1_epi8((char)cx), pattern_x));
+        _mm_storeu_si128((__m128i *)&y[i], _mm_add_epi8(_mm_set1_epi8((char)cy), pattern_y));
+    }
+}
+
+__attribute__((target("avx2"))) static void z_curve_avx2_magic_8bit(size_t max, coord8_t *x, coord8_t *y)
+{
+    __m256i pattern_x = _mm256_loadu_si256((const __m256i *)offset_x);
+    __m256i pattern_y = _mm256_loadu_si256((const __m256i *)offset_y);
+
+    for (size_t i = 0; i < max; i += 32)
+    {
+        coord_t cx, cy;
+        decode(i, &cx, &cy);
+
+        _mm256_storeu_si256((__m256i *)&x[i], _mm256_add_epi8(_mm256_set1_epi8((char)cx), pattern_x));
+        _mm256_storeu_si256((__m256i *)&y[i], _mm256_add_epi8(_mm256_set1_epi8((char)cy), pattern_y));
+    }
+}
+
+void z_curve_simd_magic_8bit(unsigned degree, coord8_t *x, coord8_t *y)
+{
+    size_t max = 1ull << (degree * 2);
+
+    if (max < 16)
+    {
+        z_curve_magic_8bit(degree, x, y);
+    }
+    else if (max >= 32 && cpu_has_avx2())
+    {
+        z_curve_avx2_magic_8bit(max, x, y);
+    }
+    else
+    {
+        z_curve_sse_magic_8bit(max, x, y);
+    }
+}
+
+void z_curve_magic_batch_at_8bit(const size_t *idx, size_t count, coord8_t *x, coord8_t *y)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        coord_t cx, cy;
+        decode(idx[i], &cx, &cy);
+        x[i] = (coord8_t)cx;
+        y[i] = (coord8_t)cy;
+    }
+}
+
+// moves the even bits of every 16 bit lane into its low byte
+static inline __m128i compact_bits_sse(__m128i z)
+{
+    z = _mm_and_si128(z, _mm_set1_epi16(0x5555));
+    z = _mm_and_si128(_mm_or_si128(z, _mm_srli_epi16(z, 1)), _mm_set1_epi16(0x3333));
+    z = _mm_and_si128(_mm_or_si128(z, _mm_srli_epi16(z, 2)), _mm_set1_epi16(0x0f0f));
+    return _mm_and_si128(_mm_or_si128(z, _mm_srli_epi16(z, 4)), _mm_set1_epi16(0x00ff));
+}
+
+// eight indices narrowed to 16 bit lanes
+static inline __m128i load_indices_sse(const size_t *idx)
+{
+    __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&idx[0]), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&idx[2]), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i c = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&idx[4]), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i d = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&idx[6]), _MM_SHUFFLE(3, 1, 2, 0));
+
+    return _mm_packus_epi32(_mm_unpacklo_epi64(a, b), _mm_unpacklo_epi64(c, d));
+}
+
+static size_t z_curve_sse_batch_at_8bit(const size_t *idx, size_t count, coord8_t *x, coord8_t *y)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i z0 = load_indices_sse(&idx[i]);
+        __m128i z1 = load_indices_sse(&idx[i + 8]);
+
+        __m128i x_vec = _mm_packus_epi16(compact_bits_sse(z0), compact_bits_sse(z1));
+        __m128i y_vec = _mm_packus_epi16(compact_bits_sse(_mm_srli_epi16(z0, 1)), compact_bits_sse(_mm_srli_epi16(z1, 1)));
+
+        _mm_storeu_si128((__m128i *)&x[i], x_vec);
+        _mm_storeu_si128((__m128i *)&y[i], y_vec);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static inline __m256i compact_bits_avx2(__m256i z)
+{
+    z = _mm256_and_si256(z, _mm256_set1_epi16(0x5555));
+    z = _mm256_and_si256(_mm256_or_si256(z, _mm256_srli_epi16(z, 1)), _mm256_set1_epi16(0x3333));
+    z = _mm256_and_si256(_mm256_or_si256(z, _mm256_srli_epi16(z, 2)), _mm256_set1_epi16(0x0f0f));
+    return _mm256_and_si256(_mm256_or_si256(z, _mm256_srli_epi16(z, 4)), _mm256_set1_epi16(0x00ff));
+}
+
+// eight indices narrowed to 32 bit lanes
+__attribute__((target("avx2"))) static inline __m256i load_indices_avx2(const size_t *idx)
+{
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&idx[0]), low_halves);
+    __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&idx[4]), low_halves);
+
+    return _mm256_permute2x128_si256(a, b, 0x20);
+}
+
+/*
+the AVX2 packs work within each 128 bit half, every pack leaves the
+64 bit quarters in the order 0 2 1 3 and one permute puts them back
+*/
+__attribute__((target("avx2"))) static size_t z_curve_avx2_batch_at_8bit(const size_t *idx, size_t count, coord8_t *x, coord8_t *y)
+{
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32)
+    {
+        __m256i z0 = _mm256_packus_epi32(load_indices_avx2(&idx[i]), load_indices_avx2(&idx[i + 8]));
+        __m256i z1 = _mm256_packus_epi32(load_indices_avx2(&idx[i + 16]), load_indices_avx2(&idx[i + 24]));
+        z0 = _mm256_permute4x64_epi64(z0, _MM_SHUFFLE(3, 1, 2, 0));
+        z1 = _mm256_permute4x64_epi64(z1, _MM_SHUFFLE(3, 1, 2, 0));
+
+        __m256i x_vec = _mm256_packus_epi16(compact_bits_avx2(z0), compact_bits_avx2(z1));
+        __m256i y_vec = _mm256_packus_epi16(compact_bits_avx2(_mm256_srli_epi16(z0, 1)), compact_bits_avx2(_mm256_srli_epi16(z1, 1)));
+
+        _mm256_storeu_si256((__m256i *)&x[i], _mm256_permute4x64_epi64(x_vec, _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_si256((__m256i *)&y[i], _mm256_permute4x64_epi64(y_vec, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+
+    return i;
+}
+
+void z_curve_simd_magic_batch_at_8bit(const size_t *idx, size_t count, coord8_t *x, coord8_t *y)
+{
+    size_t done = cpu_has_avx2() ? z_curve_avx2_batch_at_8bit(idx, count, x, y) : 0;
+
+    done += z_curve_sse_batch_at_8bit(idx + done, count - done, x + done, y + done);
+
+    z_curve_magic_batch_at_8bit(idx + done, count - done, x + done, y + done);
+}
+
+void z_curve_widen_8bit(const coord8_t *src, coord_t *dst, size_t count)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)&src[i]);
+        _mm_storeu_si128((__m128i *)&dst[i], _mm_cvtepu8_epi16(v));
+        _mm_storeu_si128((__m128i *)&dst[i + 8], _mm_cvtepu8_epi16(_mm_srli_si128(v, 8)));
+    }
+
+    for (; i < count; ++i)
+    {
+        dst[i] = src[i];
+    }
+}
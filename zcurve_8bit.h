@@ -0,0 +1,27 @@
+#ifndef _ZCURVE_8BIT_H
+#define _ZCURVE_8BIT_H
+
+#include <stdbool.h>
+
+#include "defs.h"
+
+/*
+8 bit coordinates for degree <= COORD8_DEGREE_MAX, half the memory and
+store bandwidth of coord_t. The batch functions need every index below
+4^COORD8_DEGREE_MAX. The SIMD versions use AVX2 when the CPU has it
+*/
+void z_curve_magic_8bit(unsigned degree, coord8_t *x, coord8_t *y);
+void z_curve_simd_magic_8bit(unsigned degree, coord8_t *x, coord8_t *y);
+
+void z_curve_magic_batch_at_8bit(const size_t *idx, size_t count, coord8_t *x, coord8_t *y);
+void z_curve_simd_magic_batch_at_8bit(const size_t *idx, size_t count, coord8_t *x, coord8_t *y);
+
+// for consumers that only take coord_t
+void z_curve_widen_8bit(const coord8_t *src, coord_t *dst, size_t count);
+
+static inline bool z_curve_fits_8bit(unsigned degree)
+{
+    return degree <= COORD8_DEGREE_MAX;
+}
+
+#endif // _ZCURVE_8BIT_H
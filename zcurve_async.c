@@ -0,0 +1,99 @@
+#include <stdlib.h>
+
+#include "zcurve_async.h"
+#include "zcurve_multithreading.h"
+#include "zcurve_scheduler.h"
+
+struct z_curve_async
+{
+    scheduler_t scheduler;
+    thread_data_t data;
+    async_status_t status;
+};
+
+static async_status_t finished_status(z_curve_async_t *handle)
+{
+    if (scheduler_progress(&handle->scheduler) == handle->scheduler.count)
+    {
+        return ASYNC_DONE;
+    }
+
+    return atomic_load(&handle->scheduler.cancelled) ? ASYNC_CANCELLED : ASYNC_FAILED;
+}
+
+z_curve_async_t *z_curve_generate_async(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads)
+{
+    z_curve_async_t *handle = malloc(sizeof(z_curve_async_t));
+    if (handle == NULL)
+    {
+        return NULL;
+    }
+
+    handle->data.degree = degree;
+    handle->data.idx = NULL;
+    handle->data.x = x;
+    handle->data.y = y;
+    handle->status = ASYNC_RUNNING;
+
+    size_t max = 1ull << (degree * 2);
+
+    if (scheduler_start(&handle->scheduler, max, CHUNK_GRANULARITY, num_threads, z_curve_thread, &handle->data))
+    {
+        scheduler_wait(&handle->scheduler);
+        scheduler_destroy(&handle->scheduler);
+        free(handle);
+        return NULL;
+    }
+
+    return handle;
+}
+
+async_status_t z_curve_async_poll(z_curve_async_t *handle, size_t *progress, size_t *prefix)
+{
+    if (progress != NULL)
+    {
+        *progress = scheduler_progress(&handle->scheduler);
+    }
+
+    if (prefix != NULL)
+    {
+        *prefix = scheduler_prefix(&handle->scheduler);
+    }
+
+    if (handle->status != ASYNC_RUNNING)
+    {
+        return handle->status;
+    }
+
+    return scheduler_running(&handle->scheduler) ? ASYNC_RUNNING : finished_status(handle);
+}
+
+async_status_t z_curve_async_wait(z_curve_async_t *handle)
+{
+    if (handle->status == ASYNC_RUNNING)
+    {
+        scheduler_wait(&handle->scheduler);
+        handle->status = finished_status(handle);
+    }
+
+    return handle->status;
+}
+
+void z_curve_async_cancel(z_curve_async_t *handle)
+{
+    scheduler_cancel(&handle->scheduler);
+}
+
+void z_curve_async_destroy(z_curve_async_t *handle)
+{
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    // the workers still reference the handle, never free it under them
+    z_curve_async_wait(handle);
+
+    scheduler_destroy(&handle->scheduler);
+    free(handle);
+}
@@ -0,0 +1,29 @@
+#ifndef _ZCURVE_ASYNC_H
+#define _ZCURVE_ASYNC_H
+
+#include "defs.h"
+
+typedef enum
+{
+    ASYNC_RUNNING,
+    ASYNC_DONE,
+    ASYNC_CANCELLED,
+    ASYNC_FAILED
+} async_status_t;
+
+typedef struct z_curve_async z_curve_async_t;
+
+/*
+starts generating the curve on num_threads worker threads and returns
+immediately; x and y must stay valid until the handle is destroyed.
+points [0, prefix) reported by z_curve_async_poll are final and may be
+read while the rest of the curve is still being generated
+*/
+z_curve_async_t *z_curve_generate_async(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads);
+
+async_status_t z_curve_async_poll(z_curve_async_t *handle, size_t *progress, size_t *prefix);
+async_status_t z_curve_async_wait(z_curve_async_t *handle);
+void z_curve_async_cancel(z_curve_async_t *handle);
+void z_curve_async_destroy(z_curve_async_t *handle);
+
+#endif // _ZCURVE_ASYNC_H
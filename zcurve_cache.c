@@ -0,0 +1,92 @@
+#define _POSIX_C_SOURCE 200809L
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "zcurve_cache.h"
+
+int z_curve_cache_path(char *path, size_t size, const char *dir, unsigned degree, const char *kernel)
+{
+    // the format version is part of the key, so files of older builds are never picked up
+    int length = snprintf(path, size, "%s/zcurve-d%02u-%s-v%u.zcv", dir, degree, kernel, CURVE_FILE_VERSION);
+    if (length < 0 || (size_t)length >= size)
+    {
+        return -1;
+    }
+
+    // keep the kernel name readable but lower case
+    for (char *p = path + length - 1; p > path && *p != '/'; --p)
+    {
+        *p = (char)tolower((unsigned char)*p);
+    }
+
+    return 0;
+}
+
+int z_curve_cache_load(const char *dir, unsigned degree, const char *kernel, curve_file_t *file)
+{
+    char path[CACHE_PATH_MAX_LENGTH];
+    if (z_curve_cache_path(path, sizeof(path), dir, degree, kernel))
+    {
+        return -1;
+    }
+
+    /*
+    header and size are checked on open, a wrong version or a truncated file
+    is a miss. An entry can also be damaged in place, by a disk error or
+    another program, so the checksum is verified as well: a single pass over
+    the mapped file, cheap next to generating, and a corrupt entry is just a
+    miss that gets overwritten by the next store
+    */
+    if (z_curve_file_open(file, path, true))
+    {
+        return -1;
+    }
+
+    if (file->degree != degree || file->layout != LAYOUT_SOA || file->x == NULL)
+    {
+        z_curve_file_close(file);
+        return -1;
+    }
+
+    return 0;
+}
+
+int z_curve_cache_store(const char *dir, unsigned degree, const char *kernel, const coord_t *x, const coord_t *y)
+{
+    char path[CACHE_PATH_MAX_LENGTH];
+    char tmp_path[CACHE_PATH_MAX_LENGTH];
+
+    if (z_curve_cache_path(path, sizeof(path), dir, degree, kernel))
+    {
+        return -1;
+    }
+
+    int length = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", path, (long)getpid());
+    if (length < 0 || (size_t)length >= sizeof(tmp_path))
+    {
+        return -1;
+    }
+
+    if (mkdir(dir, 0777) && errno != EEXIST)
+    {
+        return -1;
+    }
+
+    if (z_curve_file_write(degree, x, y, LAYOUT_SOA, tmp_path))
+    {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    // readers either see the old file or the complete new one, never a partial write
+    if (rename(tmp_path, path))
+    {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    return 0;
+}
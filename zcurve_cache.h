@@ -0,0 +1,18 @@
+#ifndef _ZCURVE_CACHE_H
+#define _ZCURVE_CACHE_H
+
+#include "defs.h"
+#include "zcurve_file.h"
+
+// environment variable that enables the cache without passing -c
+#define CACHE_DIR_ENV "ZCURVE_CACHE_DIR"
+
+#define CACHE_PATH_MAX_LENGTH 4096
+
+int z_curve_cache_path(char *path, size_t size, const char *dir, unsigned degree, const char *kernel);
+
+// 0 on a hit with the curve mapped into file, -1 on a miss
+int z_curve_cache_load(const char *dir, unsigned degree, const char *kernel, curve_file_t *file);
+int z_curve_cache_store(const char *dir, unsigned degree, const char *kernel, const coord_t *x, const coord_t *y);
+
+#endif // _ZCURVE_CACHE_H
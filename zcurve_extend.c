@@ -0,0 +1,88 @@
+#include "zcurve_extend.h"
+#include "zcurve_multithreading.h"
+#include "zcurve_simd.h"
+
+typedef struct
+{
+    unsigned degree;
+    store_mode_t mode;
+    coord_t *x;
+    coord_t *y;
+} extend_data_t;
+
+static inline void extend_point(size_t quarter, coord_t offset, size_t i, coord_t *x, coord_t *y)
+{
+    x[quarter + i] = x[i] + offset;
+    y[quarter + i] = y[i];
+    x[2 * quarter + i] = x[i];
+    y[2 * quarter + i] = y[i] + offset;
+    x[3 * quarter + i] = x[i] + offset;
+    y[3 * quarter + i] = y[i] + offset;
+}
+
+// copies the old points [start, end) into the three new quadrants
+static inline __attribute__((always_inline)) void z_curve_extend_kernel(unsigned degree, size_t start, size_t end, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    size_t quarter = 1ull << (degree * 2);
+    coord_t offset = (coord_t)(1u << degree);
+
+    size_t i = start;
+
+    // up to a multiple of 8 points, the quarters are multiples of 8 as well so all stores line up
+    for (; i < end && (i & 7); ++i)
+    {
+        extend_point(quarter, offset, i, x, y);
+    }
+
+    __m128i offset_vec = _mm_set1_epi16((short)offset);
+
+    for (; i + 8 <= end; i += 8)
+    {
+        __m128i x_vec = _mm_loadu_si128((const __m128i *)&x[i]);
+        __m128i y_vec = _mm_loadu_si128((const __m128i *)&y[i]);
+
+        __m128i x_offset = _mm_add_epi16(x_vec, offset_vec);
+        __m128i y_offset = _mm_add_epi16(y_vec, offset_vec);
+
+        store_si128(&x[quarter + i], x_offset, mode);
+        store_si128(&y[quarter + i], y_vec, mode);
+        store_si128(&x[2 * quarter + i], x_vec, mode);
+        store_si128(&y[2 * quarter + i], y_offset, mode);
+        store_si128(&x[3 * quarter + i], x_offset, mode);
+        store_si128(&y[3 * quarter + i], y_offset, mode);
+    }
+
+    for (; i < end; ++i)
+    {
+        extend_point(quarter, offset, i, x, y);
+    }
+}
+
+static void z_curve_extend_range(unsigned degree, size_t start, size_t end, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    STORE_MODE_DISPATCH(mode, z_curve_extend_kernel, degree, start, end, x, y);
+}
+
+void z_curve_extend(unsigned degree, coord_t *x, coord_t *y)
+{
+    z_curve_extend_range(degree, 0, 1ull << (degree * 2), x, y, select_store_mode(degree + 1, x, y));
+}
+
+static void z_curve_extend_thread(size_t start, size_t end, void *arg)
+{
+    extend_data_t *data = (extend_data_t *)arg;
+
+    z_curve_extend_range(data->degree, start, end, data->x, data->y, data->mode);
+}
+
+int z_curve_extend_multithreaded(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads)
+{
+    extend_data_t data = {.degree = degree, .mode = select_store_mode(degree + 1, x, y), .x = x, .y = y};
+    scheduler_t scheduler;
+
+    int result = parallel_for(&scheduler, 1ull << (degree * 2), CHUNK_GRANULARITY, num_threads, z_curve_extend_thread, &data);
+
+    scheduler_destroy(&scheduler);
+
+    return result;
+}
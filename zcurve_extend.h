@@ -0,0 +1,16 @@
+#ifndef _ZCURVE_EXTEND_H
+#define _ZCURVE_EXTEND_H
+
+#include "defs.h"
+
+/*
+the curve of degree d + 1 is the curve of degree d four times over: the
+points of quadrant q = idx >> 2d are the old points offset by
+((q & 1) << d, (q >> 1) << d). The first quarter of the buffer already is
+the old curve, so extending only fills the other three quarters from it.
+x and y need room for 4^(d + 1) points and d must be below DEGREE_MAX
+*/
+void z_curve_extend(unsigned degree, coord_t *x, coord_t *y);
+int z_curve_extend_multithreaded(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads);
+
+#endif // _ZCURVE_EXTEND_H
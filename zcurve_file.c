@@ -0,0 +1,480 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <immintrin.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "zcurve_file.h"
+
+static inline size_t round_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+// crc32c of the coordinates x[0], x[stride], ..., using the SSE4.2 instruction
+uint32_t curve_crc32c(uint32_t crc, const coord_t *x, size_t count, size_t stride)
+{
+    size_t i = 0;
+
+    if (stride == 1)
+    {
+        // four coordinates per instruction
+        for (; i + 4 <= count; i += 4)
+        {
+            uint64_t value;
+            memcpy(&value, &x[i], sizeof(value));
+            crc = (uint32_t)_mm_crc32_u64(crc, value);
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        crc = _mm_crc32_u16(crc, x[i * stride]);
+    }
+
+    return crc;
+}
+
+static uint32_t curve_crc32c_8bit(uint32_t crc, const coord8_t *x, size_t count, size_t stride)
+{
+    size_t i = 0;
+
+    if (stride == 1)
+    {
+        for (; i + 8 <= count; i += 8)
+        {
+            uint64_t value;
+            memcpy(&value, &x[i], sizeof(value));
+            crc = (uint32_t)_mm_crc32_u64(crc, value);
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        crc = _mm_crc32_u8(crc, x[i * stride]);
+    }
+
+    return crc;
+}
+
+static int pwrite_all(int fd, const void *data, size_t size, size_t offset)
+{
+    const char *p = (const char *)data;
+
+    while (size)
+    {
+        ssize_t written = pwrite(fd, p, size, offset);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        p += written;
+        size -= written;
+        offset += written;
+    }
+
+    return 0;
+}
+
+static int curve_file_begin(void *ctx, unsigned degree)
+{
+    curve_file_writer_t *writer = (curve_file_writer_t *)ctx;
+    curve_file_header_t *header = &writer->header;
+
+    size_t num_points = 1ull << (degree * 2);
+    size_t array_size = num_points * writer->coord_width;
+
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, CURVE_FILE_MAGIC, sizeof(header->magic));
+    header->version = CURVE_FILE_VERSION;
+    header->degree = degree;
+    header->coord_width = writer->coord_width;
+    header->layout = writer->layout;
+    header->num_points = num_points;
+    header->x_offset = CURVE_FILE_ALIGNMENT;
+
+    size_t file_size;
+    if (writer->layout == LAYOUT_AOS)
+    {
+        header->y_offset = header->x_offset + writer->coord_width;
+        file_size = header->x_offset + array_size * 2;
+    }
+    else
+    {
+        header->y_offset = header->x_offset + round_up(array_size, CURVE_FILE_ALIGNMENT);
+        file_size = header->y_offset + array_size;
+    }
+
+    writer->crc_x = 0;
+    writer->crc_y = 0;
+    writer->points_written = 0;
+    writer->buffer = NULL;
+
+    writer->fd = open(writer->filename, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (writer->fd < 0)
+    {
+        fprintf(stderr, "Failed to open %s!\n", writer->filename);
+        return -1;
+    }
+
+    // size the file up front, the blocks are written into place
+    if (ftruncate(writer->fd, file_size))
+    {
+        fprintf(stderr, "Failed to resize %s!\n", writer->filename);
+        close(writer->fd);
+        writer->fd = -1;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int curve_file_write(void *ctx, const coord_t *x, const coord_t *y, size_t start, size_t count)
+{
+    curve_file_writer_t *writer = (curve_file_writer_t *)ctx;
+    curve_file_header_t *header = &writer->header;
+
+    writer->crc_x = curve_crc32c(writer->crc_x, x, count, 1);
+    writer->crc_y = curve_crc32c(writer->crc_y, y, count, 1);
+
+    if (writer->layout == LAYOUT_SOA)
+    {
+        if (pwrite_all(writer->fd, x, count * sizeof(coord_t), header->x_offset + start * sizeof(coord_t)) ||
+            pwrite_all(writer->fd, y, count * sizeof(coord_t), header->y_offset + start * sizeof(coord_t)))
+        {
+            return -1;
+        }
+
+        writer->points_written += count;
+
+        return 0;
+    }
+
+    if (writer->buffer == NULL)
+    {
+        writer->buffer = malloc(sizeof(coord_t) * 2 * PIPELINE_BLOCK_POINTS);
+        if (writer->buffer == NULL)
+        {
+            return -1;
+        }
+    }
+
+    // interleave block by block into {x, y} pairs
+    while (count)
+    {
+        size_t n = count < PIPELINE_BLOCK_POINTS ? count : PIPELINE_BLOCK_POINTS;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            writer->buffer[i * 2] = x[i];
+            writer->buffer[i * 2 + 1] = y[i];
+        }
+
+        if (pwrite_all(writer->fd, writer->buffer, n * sizeof(coord_t) * 2, header->x_offset + start * sizeof(coord_t) * 2))
+        {
+            return -1;
+        }
+
+        x += n;
+        y += n;
+        start += n;
+        count -= n;
+        writer->points_written += n;
+    }
+
+    return 0;
+}
+
+static int curve_file_end(void *ctx)
+{
+    curve_file_writer_t *writer = (curve_file_writer_t *)ctx;
+    curve_file_header_t *header = &writer->header;
+
+    free(writer->buffer);
+    writer->buffer = NULL;
+
+    if (writer->fd < 0)
+    {
+        return -1;
+    }
+
+    /*
+    the header goes last and only after every point was written, so a file
+    with a valid header is a complete file. A failed or cancelled write
+    leaves the zeroed header of the truncated file, which no reader accepts
+    */
+    int result = -1;
+
+    if (writer->points_written == header->num_points)
+    {
+        header->checksum = (uint64_t)writer->crc_x | ((uint64_t)writer->crc_y << 32);
+        result = pwrite_all(writer->fd, header, sizeof(*header), 0);
+    }
+
+    if (close(writer->fd))
+    {
+        result = -1;
+    }
+
+    writer->fd = -1;
+
+    return result;
+}
+
+void curve_file_sink_init(curve_file_writer_t *writer, curve_sink_t *sink, curve_layout_t layout, char *filename)
+{
+    writer->fd = -1;
+    writer->filename = filename;
+    writer->layout = layout;
+    writer->coord_width = sizeof(coord_t);
+    writer->buffer = NULL;
+
+    sink->begin = curve_file_begin;
+    sink->write = curve_file_write;
+    sink->end = curve_file_end;
+    sink->ctx = writer;
+}
+
+int z_curve_file_write(unsigned degree, const coord_t *x, const coord_t *y, curve_layout_t layout, char *filename)
+{
+    size_t max = 1ull << (degree * 2);
+
+    curve_file_writer_t writer;
+    curve_sink_t sink;
+    curve_file_sink_init(&writer, &sink, layout, filename);
+
+    if (sink.begin(sink.ctx, degree))
+    {
+        return -1;
+    }
+
+    int result = sink.write(sink.ctx, x, y, 0, max);
+
+    if (sink.end(sink.ctx))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+int z_curve_file_write_points(unsigned degree, const point_t *points, char *filename)
+{
+    size_t max = 1ull << (degree * 2);
+    const coord_t *xy = (const coord_t *)points;
+
+    curve_file_writer_t writer;
+    curve_sink_t sink;
+    curve_file_sink_init(&writer, &sink, LAYOUT_AOS, filename);
+
+    if (sink.begin(sink.ctx, degree))
+    {
+        return -1;
+    }
+
+    writer.crc_x = curve_crc32c(0, xy, max, 2);
+    writer.crc_y = curve_crc32c(0, xy + 1, max, 2);
+
+    int result = pwrite_all(writer.fd, points, max * sizeof(point_t), writer.header.x_offset);
+    if (!result)
+    {
+        writer.points_written = max;
+    }
+
+    if (sink.end(sink.ctx))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+int z_curve_file_write_8bit(unsigned degree, const coord8_t *x, const coord8_t *y, curve_layout_t layout, char *filename)
+{
+    size_t max = 1ull << (degree * 2);
+
+    curve_file_writer_t writer;
+    curve_sink_t sink;
+    curve_file_sink_init(&writer, &sink, layout, filename);
+    writer.coord_width = sizeof(coord8_t);
+
+    if (sink.begin(sink.ctx, degree))
+    {
+        return -1;
+    }
+
+    writer.crc_x = curve_crc32c_8bit(0, x, max, 1);
+    writer.crc_y = curve_crc32c_8bit(0, y, max, 1);
+
+    int result = 0;
+    if (layout == LAYOUT_SOA)
+    {
+        result = pwrite_all(writer.fd, x, max, writer.header.x_offset) || pwrite_all(writer.fd, y, max, writer.header.y_offset) ? -1 : 0;
+    }
+    else
+    {
+        // a curve with 8 bit coordinates has at most 64 Ki points, interleave all at once
+        coord8_t *buffer = malloc(max * 2);
+        if (buffer == NULL)
+        {
+            result = -1;
+        }
+        else
+        {
+            for (size_t i = 0; i < max; ++i)
+            {
+                buffer[i * 2] = x[i];
+                buffer[i * 2 + 1] = y[i];
+            }
+
+            result = pwrite_all(writer.fd, buffer, max * 2, writer.header.x_offset);
+            free(buffer);
+        }
+    }
+
+    if (!result)
+    {
+        writer.points_written = max;
+    }
+
+    if (sink.end(sink.ctx))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+// off + size <= file_size without the sum overflowing
+static inline bool range_fits(uint64_t off, uint64_t size, uint64_t file_size)
+{
+    return off <= file_size && size <= file_size - off;
+}
+
+/*
+the degree and num_points are checked already, so array_size cannot
+overflow. The offsets come straight from the file and are checked
+without adding them up, and pairs must sit right next to each other
+*/
+static bool curve_file_arrays_fit(const curve_file_header_t *header, uint64_t file_size)
+{
+    uint64_t array_size = header->num_points * header->coord_width;
+
+    if (header->x_offset % CURVE_FILE_ALIGNMENT || header->y_offset % header->coord_width)
+    {
+        return false;
+    }
+
+    if (header->layout == LAYOUT_AOS)
+    {
+        return header->y_offset == header->x_offset + header->coord_width &&
+               range_fits(header->x_offset, array_size * 2, file_size);
+    }
+
+    return range_fits(header->x_offset, array_size, file_size) && range_fits(header->y_offset, array_size, file_size);
+}
+
+int z_curve_file_open(curve_file_t *file, const char *filename, bool verify)
+{
+    memset(file, 0, sizeof(*file));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(curve_file_header_t))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+    // the mapping keeps the file alive on its own
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    const curve_file_header_t *header = (const curve_file_header_t *)map;
+
+    if (memcmp(header->magic, CURVE_FILE_MAGIC, sizeof(header->magic)) ||
+        header->version != CURVE_FILE_VERSION ||
+        (header->coord_width != sizeof(coord_t) && header->coord_width != sizeof(coord8_t)) ||
+        header->layout >= MAX_LAYOUT ||
+        header->degree == 0 || header->degree > DEGREE_MAX ||
+        (header->coord_width == sizeof(coord8_t) && header->degree > COORD8_DEGREE_MAX) ||
+        header->num_points != 1ull << (header->degree * 2) ||
+        !curve_file_arrays_fit(header, st.st_size))
+    {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    if (header->coord_width == sizeof(coord8_t))
+    {
+        file->x8 = (const coord8_t *)map + header->x_offset;
+        file->y8 = (const coord8_t *)map + header->y_offset;
+    }
+    else
+    {
+        file->x = (const coord_t *)((const char *)map + header->x_offset);
+        file->y = (const coord_t *)((const char *)map + header->y_offset);
+    }
+
+    file->coord_width = header->coord_width;
+    file->stride = header->layout == LAYOUT_AOS ? 2 : 1;
+    file->num_points = header->num_points;
+    file->degree = header->degree;
+    file->layout = header->layout;
+    file->map = map;
+    file->map_size = st.st_size;
+
+    if (verify)
+    {
+        uint32_t crc_x, crc_y;
+        if (file->coord_width == sizeof(coord8_t))
+        {
+            crc_x = curve_crc32c_8bit(0, file->x8, file->num_points, file->stride);
+            crc_y = curve_crc32c_8bit(0, file->y8, file->num_points, file->stride);
+        }
+        else
+        {
+            crc_x = curve_crc32c(0, file->x, file->num_points, file->stride);
+            crc_y = curve_crc32c(0, file->y, file->num_points, file->stride);
+        }
+
+        if (((uint64_t)crc_x | ((uint64_t)crc_y << 32)) != header->checksum)
+        {
+            z_curve_file_close(file);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+void z_curve_file_close(curve_file_t *file)
+{
+    if (file->map != NULL)
+    {
+        munmap(file->map, file->map_size);
+    }
+
+    memset(file, 0, sizeof(*file));
+}
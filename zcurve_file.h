@@ -0,0 +1,91 @@
+#ifndef _ZCURVE_FILE_H
+#define _ZCURVE_FILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "defs.h"
+#include "zcurve_pipeline.h"
+
+#define CURVE_FILE_MAGIC "ZCURVE\r\n"
+#define CURVE_FILE_VERSION 1
+
+// the coordinate arrays start on a page boundary, so they can be mapped directly
+#define CURVE_FILE_ALIGNMENT 4096
+
+#define CURVE_FILE_FILENAME_DEFAULT "zcurve.zcv"
+
+typedef enum
+{
+    LAYOUT_SOA,
+    LAYOUT_AOS,
+    MAX_LAYOUT
+} curve_layout_t;
+
+/*
+on-disk header, little endian, followed by the coordinates at x_offset and
+y_offset: for LAYOUT_SOA two separate arrays, for LAYOUT_AOS one array of
+{x, y} pairs with y_offset = x_offset + coord_width. The checksum covers
+the logical x and y sequences, so it does not depend on the layout:
+crc32c(x) in the low and crc32c(y) in the high 32 bits.
+coord_width is sizeof(coord_t), or 1 for curves stored with 8 bit
+coordinates, the checksum covers the stored values in both cases
+*/
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t degree;
+    uint32_t coord_width;
+    uint32_t layout;
+    uint64_t num_points;
+    uint64_t x_offset;
+    uint64_t y_offset;
+    uint64_t checksum;
+} curve_file_header_t;
+
+typedef struct
+{
+    int fd;
+    char *filename;
+    curve_layout_t layout;
+    unsigned coord_width;
+    curve_file_header_t header;
+    uint32_t crc_x;
+    uint32_t crc_y;
+    // the header is only written once every point made it to the file
+    size_t points_written;
+    coord_t *buffer;
+} curve_file_writer_t;
+
+// exactly one of x/y and x8/y8 is set, depending on coord_width
+typedef struct
+{
+    const coord_t *x;
+    const coord_t *y;
+    const coord8_t *x8;
+    const coord8_t *y8;
+    unsigned coord_width;
+    size_t stride;
+    size_t num_points;
+    unsigned degree;
+    curve_layout_t layout;
+    void *map;
+    size_t map_size;
+} curve_file_t;
+
+// crc32c of x[0], x[stride], ..., the per-array half of the file checksum
+uint32_t curve_crc32c(uint32_t crc, const coord_t *x, size_t count, size_t stride);
+
+// writer, usable as sink of z_curve_pipeline
+void curve_file_sink_init(curve_file_writer_t *writer, curve_sink_t *sink, curve_layout_t layout, char *filename);
+int z_curve_file_write(unsigned degree, const coord_t *x, const coord_t *y, curve_layout_t layout, char *filename);
+// pairs and keys go out as LAYOUT_AOS without a transpose
+int z_curve_file_write_points(unsigned degree, const point_t *points, char *filename);
+int z_curve_file_write_8bit(unsigned degree, const coord8_t *x, const coord8_t *y, curve_layout_t layout, char *filename);
+
+// zero-copy reader, point i is at x[i * stride] and y[i * stride]
+int z_curve_file_open(curve_file_t *file, const char *filename, bool verify);
+void z_curve_file_close(curve_file_t *file);
+
+#endif // _ZCURVE_FILE_H
@@ -0,0 +1,119 @@
+#include "zcurve_grid.h"
+#include "zcurve_codec.h"
+#include "zcurve_multithreading.h"
+#include "zcurve_simd.h"
+
+// cells per scheduler chunk, narrow grids hand out several rows at once
+#define GRID_CHUNK_CELLS (1u << 14)
+
+// dilated x sits in the even bits, dilated y in the odd ones
+#define GRID_EVEN_BITS 0x55555555
+#define GRID_ODD_BITS 0xAAAAAAAA
+
+typedef struct
+{
+    unsigned degree;
+    store_mode_t mode;
+    uint32_t *grid;
+} grid_data_t;
+
+void z_curve_grid(unsigned degree, uint32_t *grid)
+{
+    size_t width = 1ull << degree;
+
+    for (size_t y = 0; y < width; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            grid[(y << degree) | x] = (uint32_t)encode((coord_t)x, (coord_t)y);
+        }
+    }
+}
+
+/*
+the index of (x, y) is dilate(x) | dilate(y) << 1, so every row dilates y
+once and only x changes along it. Instead of dilating each x, the dilated
+values are advanced in place: filling the odd bits with ones lets the
+carry of a plain add ripple across them, and masking them off again gives
+dilate(x + step) = ((dilate(x) | odd) + dilate(step)) & even
+*/
+static inline __attribute__((always_inline)) void z_curve_grid_kernel(unsigned degree, size_t row_begin, size_t row_end, uint32_t *grid, store_mode_t mode)
+{
+    size_t width = 1ull << degree;
+
+    // narrow rows do not fill the two vectors
+    if (width < 8)
+    {
+        for (size_t y = row_begin; y < row_end; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                grid[(y << degree) | x] = (uint32_t)encode((coord_t)x, (coord_t)y);
+            }
+        }
+
+        return;
+    }
+
+    __m128i even = _mm_set1_epi32((int)GRID_EVEN_BITS);
+    __m128i odd = _mm_set1_epi32((int)GRID_ODD_BITS);
+
+    // dilate(8), both vectors move eight cells per iteration
+    __m128i step = _mm_set1_epi32(0x40);
+
+    for (size_t y = row_begin; y < row_end; ++y)
+    {
+        __m128i dy = _mm_set1_epi32((int)encode(0, (coord_t)y));
+
+        // dilate(0..3) and dilate(4..7)
+        __m128i lo = _mm_set_epi32(0x05, 0x04, 0x01, 0x00);
+        __m128i hi = _mm_set_epi32(0x15, 0x14, 0x11, 0x10);
+
+        uint32_t *row = &grid[y << degree];
+
+        for (size_t x = 0; x < width; x += 8)
+        {
+            store_si128((coord_t *)&row[x], _mm_or_si128(lo, dy), mode);
+            store_si128((coord_t *)&row[x + 4], _mm_or_si128(hi, dy), mode);
+
+            lo = _mm_and_si128(_mm_add_epi32(_mm_or_si128(lo, odd), step), even);
+            hi = _mm_and_si128(_mm_add_epi32(_mm_or_si128(hi, odd), step), even);
+        }
+    }
+}
+
+static void z_curve_grid_rows(unsigned degree, size_t row_begin, size_t row_end, uint32_t *grid, store_mode_t mode)
+{
+    STORE_MODE_DISPATCH(mode, z_curve_grid_kernel, degree, row_begin, row_end, grid);
+}
+
+// a cell takes as many bytes as a point of the curve, so the curve's store mode fits the grid as well
+static inline store_mode_t select_grid_store_mode(unsigned degree, const uint32_t *grid)
+{
+    return select_store_mode(degree, (const coord_t *)grid, (const coord_t *)grid);
+}
+
+void z_curve_grid_simd(unsigned degree, uint32_t *grid)
+{
+    z_curve_grid_rows(degree, 0, 1ull << degree, grid, select_grid_store_mode(degree, grid));
+}
+
+static void z_curve_grid_thread(size_t row_begin, size_t row_end, void *arg)
+{
+    grid_data_t *data = (grid_data_t *)arg;
+
+    z_curve_grid_rows(data->degree, row_begin, row_end, data->grid, data->mode);
+}
+
+int z_curve_grid_multithreaded(unsigned degree, uint32_t *grid, unsigned num_threads)
+{
+    grid_data_t data = {.degree = degree, .mode = select_grid_store_mode(degree, grid), .grid = grid};
+    size_t rows = 1ull << degree;
+    size_t chunk_rows = (GRID_CHUNK_CELLS >> degree) ? (GRID_CHUNK_CELLS >> degree) : 1;
+
+    scheduler_t scheduler;
+    int result = parallel_for_chunks(&scheduler, rows, chunk_rows, num_threads, z_curve_grid_thread, &data);
+    scheduler_destroy(&scheduler);
+
+    return result;
+}
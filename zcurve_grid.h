@@ -0,0 +1,18 @@
+#ifndef _ZCURVE_GRID_H
+#define _ZCURVE_GRID_H
+
+#include <stdint.h>
+
+#include "defs.h"
+
+/*
+inverse of the curve: a row-major 2^d x 2^d grid where cell (x, y) at
+grid[(y << d) | x] holds the index of that point on the curve. Rows share
+the dilated y, so the x part is the only one that changes along a row.
+grid needs room for 4^d cells
+*/
+void z_curve_grid(unsigned degree, uint32_t *grid);
+void z_curve_grid_simd(unsigned degree, uint32_t *grid);
+int z_curve_grid_multithreaded(unsigned degree, uint32_t *grid, unsigned num_threads);
+
+#endif // _ZCURVE_GRID_H
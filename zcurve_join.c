@@ -0,0 +1,295 @@
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "zcurve_join.h"
+#include "zcurve_codec.h"
+#include "zcurve_multithreading.h"
+
+typedef struct
+{
+    const join_input_t *input;
+    unsigned level;
+    unsigned radius;
+    bool distance;
+    atomic_size_t pairs;
+} join_data_t;
+
+// first position in [begin, end) whose key is not below key
+static size_t lower_bound(const size_t *keys, size_t begin, size_t end, size_t key)
+{
+    while (begin < end)
+    {
+        size_t mid = begin + (end - begin) / 2;
+
+        if (keys[mid] < key)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+
+    return begin;
+}
+
+// lower_bound for keys expected close to begin, as in a merge
+static size_t gallop(const size_t *keys, size_t begin, size_t end, size_t key)
+{
+    size_t step = 1;
+
+    while (begin + step < end && keys[begin + step] < key)
+    {
+        step *= 2;
+    }
+
+    return lower_bound(keys, begin + step / 2, begin + step < end ? begin + step : end, key);
+}
+
+unsigned z_curve_join_level(unsigned degree, unsigned radius)
+{
+    unsigned bits = 0;
+
+    while (bits < degree && (1u << bits) < radius)
+    {
+        ++bits;
+    }
+
+    return degree - bits;
+}
+
+/*
+a merge of the two key sequences on their cell prefix: runs of equal
+prefixes are paired up and everything else is skipped by galloping, so
+both sets are swept once. Only the keys of a in [key_begin, key_end)
+start pairs
+*/
+static size_t join_cells_range(const join_input_t *input, unsigned level, size_t key_begin, size_t key_end)
+{
+    unsigned shift = (input->degree - level) * 2;
+
+    size_t i = lower_bound(input->a, 0, input->a_count, key_begin);
+    size_t i_end = lower_bound(input->a, i, input->a_count, key_end);
+    size_t j = lower_bound(input->b, 0, input->b_count, key_begin);
+    size_t j_end = lower_bound(input->b, j, input->b_count, key_end);
+
+    size_t pairs = 0;
+
+    while (i < i_end && j < j_end)
+    {
+        size_t prefix_a = input->a[i] >> shift;
+        size_t prefix_b = input->b[j] >> shift;
+
+        if (prefix_a < prefix_b)
+        {
+            i = gallop(input->a, i, i_end, prefix_b << shift);
+        }
+        else if (prefix_b < prefix_a)
+        {
+            j = gallop(input->b, j, j_end, prefix_a << shift);
+        }
+        else
+        {
+            size_t bound = (prefix_a + 1) << shift;
+            size_t i_next = gallop(input->a, i, i_end, bound);
+            size_t j_next = gallop(input->b, j, j_end, bound);
+
+            pairs += (i_next - i) * (j_next - j);
+
+            if (input->fn != NULL)
+            {
+                for (size_t p = i; p < i_next; ++p)
+                {
+                    for (size_t q = j; q < j_next; ++q)
+                    {
+                        input->fn(p, q, input->arg);
+                    }
+                }
+            }
+
+            i = i_next;
+            j = j_next;
+        }
+    }
+
+    return pairs;
+}
+
+/*
+the up to nine cells around a cell at the join level, as sorted runs of
+consecutive prefixes: every run is a single interval of keys and so a
+single range of b. Returns the number of runs
+*/
+static unsigned neighbour_intervals(unsigned level, size_t prefix, size_t *first, size_t *last)
+{
+    coord_t gx, gy;
+    decode(prefix, &gx, &gy);
+
+    long grid = 1l << level;
+    size_t cells[9];
+    unsigned count = 0;
+
+    for (long y = (long)gy - 1; y <= (long)gy + 1; ++y)
+    {
+        for (long x = (long)gx - 1; x <= (long)gx + 1; ++x)
+        {
+            if (x < 0 || y < 0 || x >= grid || y >= grid)
+            {
+                continue;
+            }
+
+            size_t cell = encode((coord_t)x, (coord_t)y);
+
+            // insertion sort, there are at most nine
+            unsigned k = count++;
+            for (; k > 0 && cells[k - 1] > cell; --k)
+            {
+                cells[k] = cells[k - 1];
+            }
+            cells[k] = cell;
+        }
+    }
+
+    unsigned runs = 0;
+
+    for (unsigned k = 0; k < count; ++k)
+    {
+        if (runs && last[runs - 1] + 1 == cells[k])
+        {
+            last[runs - 1] = cells[k];
+        }
+        else
+        {
+            first[runs] = cells[k];
+            last[runs] = cells[k];
+            ++runs;
+        }
+    }
+
+    return runs;
+}
+
+/*
+cells are at least radius wide, so a point of a only has partners in
+its own cell and the eight around it. The cells of a are swept in order
+and their neighbourhood is looked up in b one key interval at a time
+*/
+static size_t join_distance_range(const join_input_t *input, unsigned radius, unsigned level, size_t key_begin, size_t key_end)
+{
+    unsigned shift = (input->degree - level) * 2;
+    uint64_t radius_squared = (uint64_t)radius * radius;
+
+    size_t i = lower_bound(input->a, 0, input->a_count, key_begin);
+    size_t i_end = lower_bound(input->a, i, input->a_count, key_end);
+
+    size_t pairs = 0;
+
+    coord_t ax[JOIN_BLOCK_POINTS], ay[JOIN_BLOCK_POINTS];
+    size_t first[9], last[9];
+
+    while (i < i_end)
+    {
+        size_t prefix = input->a[i] >> shift;
+        size_t i_next = gallop(input->a, i, i_end, (prefix + 1) << shift);
+
+        unsigned runs = neighbour_intervals(level, prefix, first, last);
+        size_t cursor = 0;
+
+        for (unsigned r = 0; r < runs; ++r)
+        {
+            size_t j = lower_bound(input->b, cursor, input->b_count, first[r] << shift);
+            size_t j_end = lower_bound(input->b, j, input->b_count, (last[r] + 1) << shift);
+            cursor = j_end;
+
+            for (size_t block = i; block < i_next && j < j_end; block += JOIN_BLOCK_POINTS)
+            {
+                size_t block_count = i_next - block < JOIN_BLOCK_POINTS ? i_next - block : JOIN_BLOCK_POINTS;
+
+                for (size_t k = 0; k < block_count; ++k)
+                {
+                    decode(input->a[block + k], &ax[k], &ay[k]);
+                }
+
+                for (size_t q = j; q < j_end; ++q)
+                {
+                    coord_t bx, by;
+                    decode(input->b[q], &bx, &by);
+
+                    for (size_t k = 0; k < block_count; ++k)
+                    {
+                        int64_t dx = (int64_t)ax[k] - bx;
+                        int64_t dy = (int64_t)ay[k] - by;
+
+                        if ((uint64_t)(dx * dx + dy * dy) <= radius_squared)
+                        {
+                            ++pairs;
+
+                            if (input->fn != NULL)
+                            {
+                                input->fn(block + k, q, input->arg);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        i = i_next;
+    }
+
+    return pairs;
+}
+
+size_t z_curve_join_cells(const join_input_t *input, unsigned level)
+{
+    return join_cells_range(input, level, 0, 1ull << (input->degree * 2));
+}
+
+size_t z_curve_join_distance(const join_input_t *input, unsigned radius)
+{
+    return join_distance_range(input, radius, z_curve_join_level(input->degree, radius), 0, 1ull << (input->degree * 2));
+}
+
+static void z_curve_join_thread(size_t start, size_t end, void *arg)
+{
+    join_data_t *data = (join_data_t *)arg;
+    unsigned shift = (data->input->degree - data->level) * 2;
+
+    // the ranges are whole cells, so no cell of a is split between two workers
+    size_t pairs = data->distance ? join_distance_range(data->input, data->radius, data->level, start << shift, end << shift)
+                                  : join_cells_range(data->input, data->level, start << shift, end << shift);
+
+    atomic_fetch_add_explicit(&data->pairs, pairs, memory_order_relaxed);
+}
+
+// the key space is split into ranges of cells at the join level, handed out by the scheduler
+static int z_curve_join_multithreaded(join_data_t *data, unsigned num_threads, size_t *pairs)
+{
+    size_t cells = 1ull << (data->level * 2);
+    size_t chunk = cells / ((size_t)num_threads * JOIN_RANGES_PER_THREAD);
+
+    scheduler_t scheduler;
+    int result = parallel_for_chunks(&scheduler, cells, chunk ? chunk : 1, num_threads, z_curve_join_thread, data);
+    scheduler_destroy(&scheduler);
+
+    *pairs = atomic_load_explicit(&data->pairs, memory_order_relaxed);
+
+    return result;
+}
+
+int z_curve_join_cells_multithreaded(const join_input_t *input, unsigned level, unsigned num_threads, size_t *pairs)
+{
+    join_data_t data = {.input = input, .level = level, .radius = 0, .distance = false};
+    atomic_init(&data.pairs, 0);
+
+    return z_curve_join_multithreaded(&data, num_threads, pairs);
+}
+
+int z_curve_join_distance_multithreaded(const join_input_t *input, unsigned radius, unsigned num_threads, size_t *pairs)
+{
+    join_data_t data = {.input = input, .level = z_curve_join_level(input->degree, radius), .radius = radius, .distance = true};
+    atomic_init(&data.pairs, 0);
+
+    return z_curve_join_multithreaded(&data, num_threads, pairs);
+}
@@ -0,0 +1,41 @@
+#ifndef _ZCURVE_JOIN_H
+#define _ZCURVE_JOIN_H
+
+#include "defs.h"
+
+// key ranges per thread, enough for the scheduler to even out clustered sets
+#define JOIN_RANGES_PER_THREAD 16
+
+// points of a cell of the first set decoded at once
+#define JOIN_BLOCK_POINTS 64
+
+// called once per pair with positions in a and in b, concurrently from the multithreaded joins
+typedef void (*join_fn_t)(size_t a, size_t b, void *arg);
+
+/*
+two point sets given as Z keys of the same degree, both sorted.
+fn may be NULL when only the number of pairs is needed
+*/
+typedef struct
+{
+    unsigned degree;
+    const size_t *a;
+    size_t a_count;
+    const size_t *b;
+    size_t b_count;
+    join_fn_t fn;
+    void *arg;
+} join_input_t;
+
+// the level whose cells are the smallest ones at least radius wide
+unsigned z_curve_join_level(unsigned degree, unsigned radius);
+
+// all pairs in the same cell of the given level, returns the number of pairs
+size_t z_curve_join_cells(const join_input_t *input, unsigned level);
+int z_curve_join_cells_multithreaded(const join_input_t *input, unsigned level, unsigned num_threads, size_t *pairs);
+
+// all pairs at most radius apart, returns the number of pairs
+size_t z_curve_join_distance(const join_input_t *input, unsigned radius);
+int z_curve_join_distance_multithreaded(const join_input_t *input, unsigned radius, unsigned num_threads, size_t *pairs);
+
+#endif // _ZCURVE_JOIN_H
@@ -1,36 +1,81 @@
 #include "zcurve_lookup.h"
-#include <immintrin.h>
-
-void z_curve_lookup_4bit(unsigned degree, coord_t *x, coord_t *y)
+#include "zcurve_simd.h"
+#include "zcurve_codec.h"
+#include "zcurve_magic.h"
+
+/*
+scalar table kernels, bits is the number of index bits per lookup. The
+specialised instances see constant degrees, so the lookups unroll fully
+and run for the zero chunks as well, the table maps 0 to (0, 0)
+*/
+static inline __attribute__((always_inline)) void z_curve_lookup_kernel(const lookup_t *table, unsigned bits, unsigned degree, coord_t *x, coord_t *y)
 {
     // number of max points is 4^degree
     size_t max = 1ull << (degree * 2);
 
-    // round up degree to next multiple of 2 and divide by 2
-    unsigned iterations = ((degree + 1) & ~1) >> 1;
+    // round up the index bits to the next multiple of the table bits
+    unsigned iterations = (degree * 2 + bits - 1) / bits;
 
     for (size_t i = 0; i < max; ++i)
     {
         size_t idx = i;
-        x[i] = 0;
-        y[i] = 0;
+        unsigned x_value = 0;
+        unsigned y_value = 0;
 
-        for (unsigned j = 0; j < iterations && idx > 0; ++j)
+        for (unsigned j = 0; j < iterations; ++j)
         {
-            // extract the last 4 bits
-            unsigned char lookup_index = idx & 0xf;
+            // extract the last bits and lookup the x and y values
+            const lookup_t *entry = &table[idx & ((1u << bits) - 1)];
 
-            // lookup the x and y values
-            unsigned x_value = lookup_table_4bit[lookup_index].x;
-            unsigned y_value = lookup_table_4bit[lookup_index].y;
-
-            // store the x and y values
-            x[i] |= x_value << (j * 2);
-            y[i] |= y_value << (j * 2);
+            x_value |= (unsigned)entry->x << (j * bits / 2);
+            y_value |= (unsigned)entry->y << (j * bits / 2);
 
             // shift the bits to the right
-            idx >>= 4;
+            idx >>= bits;
         }
+
+        x[i] = (coord_t)x_value;
+        y[i] = (coord_t)y_value;
+    }
+}
+
+typedef void (*z_curve_lookup_kernel_t)(coord_t *x, coord_t *y);
+
+#define Z_CURVE_LOOKUP_KERNELS(d)                                 \
+    static void z_curve_lookup_4bit_d##d(coord_t *x, coord_t *y)  \
+    {                                                             \
+        z_curve_lookup_kernel(lookup_table_4bit, 4, d, x, y);     \
+    }                                                             \
+    static void z_curve_lookup_8bit_d##d(coord_t *x, coord_t *y)  \
+    {                                                             \
+        z_curve_lookup_kernel(lookup_table_8bit, 8, d, x, y);     \
+    }                                                             \
+    static void z_curve_lookup_16bit_d##d(coord_t *x, coord_t *y) \
+    {                                                             \
+        z_curve_lookup_kernel(lookup_table_16bit, 16, d, x, y);   \
+    }
+FOR_EACH_DEGREE(Z_CURVE_LOOKUP_KERNELS)
+#undef Z_CURVE_LOOKUP_KERNELS
+
+#define Z_CURVE_LOOKUP_4BIT_ENTRY(d) z_curve_lookup_4bit_d##d,
+#define Z_CURVE_LOOKUP_8BIT_ENTRY(d) z_curve_lookup_8bit_d##d,
+#define Z_CURVE_LOOKUP_16BIT_ENTRY(d) z_curve_lookup_16bit_d##d,
+static const z_curve_lookup_kernel_t z_curve_lookup_4bit_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_LOOKUP_4BIT_ENTRY)};
+static const z_curve_lookup_kernel_t z_curve_lookup_8bit_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_LOOKUP_8BIT_ENTRY)};
+static const z_curve_lookup_kernel_t z_curve_lookup_16bit_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_LOOKUP_16BIT_ENTRY)};
+#undef Z_CURVE_LOOKUP_4BIT_ENTRY
+#undef Z_CURVE_LOOKUP_8BIT_ENTRY
+#undef Z_CURVE_LOOKUP_16BIT_ENTRY
+
+void z_curve_lookup_4bit(unsigned degree, coord_t *x, coord_t *y)
+{
+    if (degree >= 1 && degree <= DEGREE_MAX)
+    {
+        z_curve_lookup_4bit_kernels[degree - 1](x, y);
+    }
+    else
+    {
+        z_curve_lookup_kernel(lookup_table_4bit, 4, degree, x, y);
     }
 }
 
@@ -67,34 +112,13 @@ void z_curve_lookup_4bit_at(unsigned degree, size_t idx, coord_t *x, coord_t *y)
 
 void z_curve_lookup_8bit(unsigned degree, coord_t *x, coord_t *y)
 {
-    // number of max points is 4^degree
-    size_t max = 1ull << (degree * 2);
-
-    // round up degree to next multiple of 4 and divide by 4
-    unsigned iterations = ((degree + 3) & ~3) >> 2;
-
-    for (size_t i = 0; i < max; ++i)
+    if (degree >= 1 && degree <= DEGREE_MAX)
     {
-        size_t idx = i;
-        x[i] = 0;
-        y[i] = 0;
-
-        for (unsigned j = 0; j < iterations && idx > 0; ++j)
-        {
-            // extract the last 8 bits
-            unsigned char lookup_index = idx & 0xff;
-
-            // lookup the x and y values
-            unsigned x_value = lookup_table_8bit[lookup_index].x;
-            unsigned y_value = lookup_table_8bit[lookup_index].y;
-
-            // store the x and y values
-            x[i] |= x_value << (j * 4);
-            y[i] |= y_value << (j * 4);
-
-            // shift the bits to the right
-            idx >>= 8;
-        }
+        z_curve_lookup_8bit_kernels[degree - 1](x, y);
+    }
+    else
+    {
+        z_curve_lookup_kernel(lookup_table_8bit, 8, degree, x, y);
     }
 }
 
@@ -131,34 +155,13 @@ void z_curve_lookup_8bit_at(unsigned degree, size_t idx, coord_t *x, coord_t *y)
 
 void z_curve_lookup_16bit(unsigned degree, coord_t *x, coord_t *y)
 {
-    // number of max points is 4^degree
-    size_t max = 1ull << (degree * 2);
-
-    // round up degree to next multiple of 8 and divide by 8
-    unsigned iterations = ((degree + 7) & ~7) >> 3;
-
-    for (size_t i = 0; i < max; ++i)
+    if (degree >= 1 && degree <= DEGREE_MAX)
     {
-        size_t idx = i;
-        x[i] = 0;
-        y[i] = 0;
-
-        for (unsigned j = 0; j < iterations && idx > 0; ++j)
-        {
-            // extract the last 16 bits
-            unsigned short lookup_index = idx & 0xffff;
-
-            // lookup the x and y values
-            unsigned x_value = lookup_table_16bit[lookup_index].x;
-            unsigned y_value = lookup_table_16bit[lookup_index].y;
-
-            // store the x and y values
-            x[i] |= x_value << (j * 8);
-            y[i] |= y_value << (j * 8);
-
-            // shift the bits to the right
-            idx >>= 16;
-        }
+        z_curve_lookup_16bit_kernels[degree - 1](x, y);
+    }
+    else
+    {
+        z_curve_lookup_kernel(lookup_table_16bit, 16, degree, x, y);
     }
 }
 
@@ -193,18 +196,140 @@ void z_curve_lookup_16bit_at(unsigned degree, size_t idx, coord_t *x, coord_t *y
     }
 }
 
-void z_curve_simd_lookup_16bit(unsigned degree, coord_t *x, coord_t *y)
+size_t z_curve_lookup_4bit_pos(unsigned degree, coord_t x, coord_t y)
 {
-    // base case
-    if (degree == 1)
+    if (degree > DEGREE_MAX)
     {
-        // base case
-        *(size_t *)x = 0x100000001ull;
-        *(size_t *)y = 0x10001ull;
+        degree = DEGREE_MAX;
+    }
 
-        return;
+    size_t idx = 0;
+
+    // round up degree to next multiple of 2 and divide by 2
+    unsigned iterations = ((degree + 1) & ~1) >> 1;
+
+    for (unsigned i = 0; i < iterations && (x | y); ++i)
+    {
+        // dilate the last 2 bits of x and y and interleave them
+        size_t value = encode_table_4bit[x & 0x3] | (encode_table_4bit[y & 0x3] << 1);
+
+        idx |= value << (i * 4);
+
+        x >>= 2;
+        y >>= 2;
+    }
+
+    return idx;
+}
+
+size_t z_curve_lookup_8bit_pos(unsigned degree, coord_t x, coord_t y)
+{
+    if (degree > DEGREE_MAX)
+    {
+        degree = DEGREE_MAX;
+    }
+
+    size_t idx = 0;
+
+    // round up degree to next multiple of 4 and divide by 4
+    unsigned iterations = ((degree + 3) & ~3) >> 2;
+
+    for (unsigned i = 0; i < iterations && (x | y); ++i)
+    {
+        // dilate the last 4 bits of x and y and interleave them
+        size_t value = encode_table_8bit[x & 0xf] | (encode_table_8bit[y & 0xf] << 1);
+
+        idx |= value << (i * 8);
+
+        x >>= 4;
+        y >>= 4;
+    }
+
+    return idx;
+}
+
+size_t z_curve_lookup_16bit_pos(unsigned degree, coord_t x, coord_t y)
+{
+    if (degree > DEGREE_MAX)
+    {
+        degree = DEGREE_MAX;
+    }
+
+    size_t idx = 0;
+
+    // round up degree to next multiple of 8 and divide by 8
+    unsigned iterations = ((degree + 7) & ~7) >> 3;
+
+    for (unsigned i = 0; i < iterations && (x | y); ++i)
+    {
+        // dilate the last 8 bits of x and y and interleave them
+        size_t value = encode_table_16bit[x & 0xff] | (encode_table_16bit[y & 0xff] << 1);
+
+        idx |= value << (i * 16);
+
+        x >>= 8;
+        y >>= 8;
     }
 
+    return idx;
+}
+
+void z_curve_lookup_16bit_pos_batch(const coord_t *x, const coord_t *y, size_t count, size_t *idx)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        idx[i] = z_curve_lookup_16bit_pos(DEGREE_MAX, x[i], y[i]);
+    }
+}
+
+/*
+eight points per iteration: the dilated bytes are looked up into 16 bit
+lanes, x and y are interleaved with a shift and or, then the low and high
+byte halves are zipped into 32 bit indices and widened to size_t
+*/
+void z_curve_simd_lookup_16bit_pos_batch(const coord_t *x, const coord_t *y, size_t count, size_t *idx)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        const coord_t *px = &x[i];
+        const coord_t *py = &y[i];
+
+        __m128i x_low = _mm_set_epi16(encode_table_16bit[px[7] & 0xff], encode_table_16bit[px[6] & 0xff],
+                                      encode_table_16bit[px[5] & 0xff], encode_table_16bit[px[4] & 0xff],
+                                      encode_table_16bit[px[3] & 0xff], encode_table_16bit[px[2] & 0xff],
+                                      encode_table_16bit[px[1] & 0xff], encode_table_16bit[px[0] & 0xff]);
+        __m128i y_low = _mm_set_epi16(encode_table_16bit[py[7] & 0xff], encode_table_16bit[py[6] & 0xff],
+                                      encode_table_16bit[py[5] & 0xff], encode_table_16bit[py[4] & 0xff],
+                                      encode_table_16bit[py[3] & 0xff], encode_table_16bit[py[2] & 0xff],
+                                      encode_table_16bit[py[1] & 0xff], encode_table_16bit[py[0] & 0xff]);
+        __m128i x_high = _mm_set_epi16(encode_table_16bit[px[7] >> 8], encode_table_16bit[px[6] >> 8],
+                                       encode_table_16bit[px[5] >> 8], encode_table_16bit[px[4] >> 8],
+                                       encode_table_16bit[px[3] >> 8], encode_table_16bit[px[2] >> 8],
+                                       encode_table_16bit[px[1] >> 8], encode_table_16bit[px[0] >> 8]);
+        __m128i y_high = _mm_set_epi16(encode_table_16bit[py[7] >> 8], encode_table_16bit[py[6] >> 8],
+                                       encode_table_16bit[py[5] >> 8], encode_table_16bit[py[4] >> 8],
+                                       encode_table_16bit[py[3] >> 8], encode_table_16bit[py[2] >> 8],
+                                       encode_table_16bit[py[1] >> 8], encode_table_16bit[py[0] >> 8]);
+
+        __m128i low = _mm_or_si128(x_low, _mm_slli_epi16(y_low, 1));
+        __m128i high = _mm_or_si128(x_high, _mm_slli_epi16(y_high, 1));
+
+        __m128i idx_0 = _mm_unpacklo_epi16(low, high);
+        __m128i idx_1 = _mm_unpackhi_epi16(low, high);
+
+        _mm_storeu_si128((__m128i *)&idx[i], _mm_cvtepu32_epi64(idx_0));
+        _mm_storeu_si128((__m128i *)&idx[i + 2], _mm_cvtepu32_epi64(_mm_srli_si128(idx_0, 8)));
+        _mm_storeu_si128((__m128i *)&idx[i + 4], _mm_cvtepu32_epi64(idx_1));
+        _mm_storeu_si128((__m128i *)&idx[i + 6], _mm_cvtepu32_epi64(_mm_srli_si128(idx_1, 8)));
+    }
+
+    z_curve_lookup_16bit_pos_batch(&x[i], &y[i], count - i, &idx[i]);
+}
+
+static inline __attribute__((always_inline)) void z_curve_simd_lookup_16bit_kernel(unsigned degree, coord_t *x, coord_t *y, store_mode_t mode)
+{
     // number of max points is 4^degree
     size_t max = 1ull << (degree * 2);
 
@@ -267,7 +392,205 @@ void z_curve_simd_lookup_16bit(unsigned degree, coord_t *x, coord_t *y)
     store:
 
         // store the x_vec and y_vec vectors to the x and y arrays
-        _mm_storeu_si128((__m128i *)&x[i << 3], x_vec);
-        _mm_storeu_si128((__m128i *)&y[i << 3], y_vec);
+        store_si128(&x[i << 3], x_vec, mode);
+        store_si128(&y[i << 3], y_vec, mode);
+    }
+}
+
+static inline __attribute__((always_inline)) void z_curve_simd_lookup_16bit_store_modes(unsigned degree, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    STORE_MODE_DISPATCH(mode, z_curve_simd_lookup_16bit_kernel, degree, x, y);
+}
+
+typedef void (*z_curve_simd_lookup_kernel_t)(coord_t *x, coord_t *y, store_mode_t mode);
+
+#define Z_CURVE_SIMD_LOOKUP_16BIT_KERNEL(d)                                               \
+    static void z_curve_simd_lookup_16bit_d##d(coord_t *x, coord_t *y, store_mode_t mode) \
+    {                                                                                     \
+        z_curve_simd_lookup_16bit_store_modes(d, x, y, mode);                             \
+    }
+FOR_EACH_DEGREE(Z_CURVE_SIMD_LOOKUP_16BIT_KERNEL)
+#undef Z_CURVE_SIMD_LOOKUP_16BIT_KERNEL
+
+#define Z_CURVE_SIMD_LOOKUP_16BIT_ENTRY(d) z_curve_simd_lookup_16bit_d##d,
+static const z_curve_simd_lookup_kernel_t z_curve_simd_lookup_16bit_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_SIMD_LOOKUP_16BIT_ENTRY)};
+#undef Z_CURVE_SIMD_LOOKUP_16BIT_ENTRY
+
+void z_curve_simd_lookup_16bit(unsigned degree, coord_t *x, coord_t *y)
+{
+    // the kernels store whole vectors, the four points of degree 1 are decoded one by one
+    if (degree == 1)
+    {
+        z_curve_magic(degree, x, y);
+        return;
+    }
+
+    store_mode_t mode = select_store_mode(degree, x, y);
+
+    if (degree >= 1 && degree <= DEGREE_MAX)
+    {
+        z_curve_simd_lookup_16bit_kernels[degree - 1](x, y, mode);
+    }
+    else
+    {
+        z_curve_simd_lookup_16bit_store_modes(degree, x, y, mode);
+    }
+}
+
+/*
+along ascending indices everything above the low 8 bits only changes every
+256 points, so the sequential decoders decode that part once per block of
+256 points and combine it with the 8 bit table, which stays in L1, for the
+low bits
+*/
+#define SEQUENTIAL_BLOCK_POINTS 256
+
+void z_curve_lookup_sequential(unsigned degree, coord_t *x, coord_t *y)
+{
+    size_t max = 1ull << (degree * 2);
+    size_t block = max < SEQUENTIAL_BLOCK_POINTS ? max : SEQUENTIAL_BLOCK_POINTS;
+
+    for (size_t base = 0; base < max; base += block)
+    {
+        // the low bits of base are zero, so this is the corner of the block
+        coord_t high_x, high_y;
+        decode(base, &high_x, &high_y);
+
+        for (size_t j = 0; j < block; ++j)
+        {
+            x[base + j] = high_x | lookup_table_8bit[j].x;
+            y[base + j] = high_y | lookup_table_8bit[j].y;
+        }
+    }
+}
+
+void z_curve_lookup_sequential_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    // no index has this prefix, so the first one always decodes
+    size_t prefix = SIZE_MAX;
+    coord_t high_x = 0, high_y = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t index = idx[i];
+
+        if ((index >> 8) != prefix)
+        {
+            prefix = index >> 8;
+            decode(index & ~(size_t)0xff, &high_x, &high_y);
+        }
+
+        x[i] = high_x | lookup_table_8bit[index & 0xff].x;
+        y[i] = high_y | lookup_table_8bit[index & 0xff].y;
+    }
+}
+
+static inline __attribute__((always_inline)) void z_curve_simd_lookup_sequential_kernel(size_t max, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    size_t block = max < SEQUENTIAL_BLOCK_POINTS ? max : SEQUENTIAL_BLOCK_POINTS;
+
+    for (size_t base = 0; base < max; base += block)
+    {
+        coord_t high_x, high_y;
+        decode(base, &high_x, &high_y);
+
+        __m128i high_x_vec = _mm_set1_epi16((short)high_x);
+        __m128i high_y_vec = _mm_set1_epi16((short)high_y);
+
+        for (size_t j = 0; j < block; j += 8)
+        {
+            __m128i x_vec = _mm_or_si128(_mm_loadu_si128((const __m128i *)&x_8bit[j]), high_x_vec);
+            __m128i y_vec = _mm_or_si128(_mm_loadu_si128((const __m128i *)&y_8bit[j]), high_y_vec);
+
+            store_si128(&x[base + j], x_vec, mode);
+            store_si128(&y[base + j], y_vec, mode);
+        }
+    }
+}
+
+void z_curve_simd_lookup_sequential(unsigned degree, coord_t *x, coord_t *y)
+{
+    size_t max = 1ull << (degree * 2);
+
+    // the vector loop needs at least 8 points
+    if (max < 8)
+    {
+        z_curve_lookup_sequential(degree, x, y);
+        return;
+    }
+
+    STORE_MODE_DISPATCH(select_store_mode(degree, x, y), z_curve_simd_lookup_sequential_kernel, max, x, y);
+}
+
+/*
+AVX2 gather decoders for unrelated indices, 8 per gather. A lookup_t is
+one 32 bit lane with x in the low and y in the high half, so shifting the
+entry of every chunk by the coordinate bits below it and or-ing them up
+gives (y << 16) | x directly
+*/
+__attribute__((target("avx2"))) static inline size_t z_curve_gather_batch_at_kernel(const lookup_t *table, unsigned bits, const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    const __m256i chunk_mask = _mm256_set1_epi32((1 << bits) - 1);
+
+    // x words to the low, y words to the high 8 bytes of each 128 bit half
+    const __m256i split = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                           0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        // narrow the 8 indices to 32 bit lanes
+        __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&idx[i]), low_halves);
+        __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&idx[i + 4]), low_halves);
+        __m256i indices = _mm256_permute2x128_si256(a, b, 0x20);
+
+        __m256i points = _mm256_setzero_si256();
+
+        for (unsigned shift = 0; shift < 32; shift += bits)
+        {
+            __m256i chunk = _mm256_and_si256(_mm256_srl_epi32(indices, _mm_cvtsi32_si128(shift)), chunk_mask);
+            __m256i entry = _mm256_i32gather_epi32((const int *)table, chunk, sizeof(lookup_t));
+
+            points = _mm256_or_si256(points, _mm256_sll_epi32(entry, _mm_cvtsi32_si128(shift >> 1)));
+        }
+
+        points = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(points, split), _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm_storeu_si128((__m128i *)&x[i], _mm256_castsi256_si128(points));
+        _mm_storeu_si128((__m128i *)&y[i], _mm256_extracti128_si256(points, 1));
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t z_curve_gather_8bit_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    return z_curve_gather_batch_at_kernel(lookup_table_8bit, 8, idx, count, x, y);
+}
+
+__attribute__((target("avx2"))) static size_t z_curve_gather_16bit_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    return z_curve_gather_batch_at_kernel(lookup_table_16bit, 16, idx, count, x, y);
+}
+
+void z_curve_simd_lookup_8bit_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    size_t i = cpu_has_avx2() ? z_curve_gather_8bit_batch_at(idx, count, x, y) : 0;
+
+    for (; i < count; ++i)
+    {
+        z_curve_lookup_8bit_at(DEGREE_MAX, idx[i], &x[i], &y[i]);
+    }
+}
+
+void z_curve_simd_lookup_16bit_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    size_t i = cpu_has_avx2() ? z_curve_gather_16bit_batch_at(idx, count, x, y) : 0;
+
+    for (; i < count; ++i)
+    {
+        z_curve_lookup_16bit_at(DEGREE_MAX, idx[i], &x[i], &y[i]);
     }
 }
@@ -5,14 +5,28 @@
 
 void z_curve_lookup_4bit(unsigned degree, coord_t *x, coord_t *y);
 void z_curve_lookup_4bit_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
+size_t z_curve_lookup_4bit_pos(unsigned degree, coord_t x, coord_t y);
 
 void z_curve_lookup_8bit(unsigned degree, coord_t *x, coord_t *y);
 void z_curve_lookup_8bit_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
+size_t z_curve_lookup_8bit_pos(unsigned degree, coord_t x, coord_t y);
 
 void z_curve_lookup_16bit(unsigned degree, coord_t *x, coord_t *y);
 void z_curve_lookup_16bit_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
+size_t z_curve_lookup_16bit_pos(unsigned degree, coord_t x, coord_t y);
+void z_curve_lookup_16bit_pos_batch(const coord_t *x, const coord_t *y, size_t count, size_t *idx);
+
+// decode the bits above the low byte once per 256 points, for ascending indices
+void z_curve_lookup_sequential(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_lookup_sequential_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y);
 
 // simd
 void z_curve_simd_lookup_16bit(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_simd_lookup_sequential(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_simd_lookup_16bit_pos_batch(const coord_t *x, const coord_t *y, size_t count, size_t *idx);
+
+// AVX2 gathers on the lookup_t tables, scalar lookups without AVX2
+void z_curve_simd_lookup_8bit_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y);
+void z_curve_simd_lookup_16bit_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y);
 
 #endif // _ZCURVE_LOOKUP_H
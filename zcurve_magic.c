@@ -1,3 +1,5 @@
+#include <stdbool.h>
+
 #include "zcurve_magic.h"
 #include "zcurve_simd.h"
 
@@ -26,19 +28,23 @@ size_t z_curve_magic_pos(unsigned degree, coord_t x, coord_t y)
     return encode(x, y);
 }
 
-void z_curve_simd_magic(unsigned degree, coord_t *x, coord_t *y)
+void z_curve_magic_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
 {
-    if (degree == 1)
+    for (size_t i = 0; i < count; ++i)
     {
-        // base case
-        *(size_t *)x = 0x100000001ull;
-        *(size_t *)y = 0x10001ull;
-
-        return;
+        decode(idx[i], &x[i], &y[i]);
     }
+}
 
-    // number of quad'Z's in the curve
-    size_t num_blocks = (1ull << (degree * 2)) >> 4;
+/*
+with interleaved set x is the output of {x, y} pairs and y is unused:
+the x and y registers are zipped with unpacklo/unpackhi right before the
+stores, so the pairs never take a second pass over memory
+*/
+static inline __attribute__((always_inline)) void z_curve_simd_magic_kernel(size_t start, size_t count, coord_t *x, coord_t *y, bool interleaved, store_mode_t mode)
+{
+    // number of quad'Z's in the range
+    size_t num_blocks = count >> 4;
 
     __m128i m0 = _mm_set_epi64x(0x5555555555555555, 0x5555555555555555);
     __m128i m1 = _mm_set_epi64x(0x3333333333333333, 0x3333333333333333);
@@ -47,7 +53,7 @@ void z_curve_simd_magic(unsigned degree, coord_t *x, coord_t *y)
 
     for (size_t i = 0; i < num_blocks; ++i)
     {
-        size_t idx0 = i << 4;
+        size_t idx0 = start + (i << 4);
         size_t idx1 = idx0 + (1 << 3);
 
         coord_t x0 = 0;
@@ -96,11 +102,128 @@ void z_curve_simd_magic(unsigned degree, coord_t *x, coord_t *y)
         __m128i x1_vec = _mm_set_epi16(x1 + 3, x1 + 2, x1 + 3, x1 + 2, x1 + 1, x1, x1 + 1, x1);
         __m128i y1_vec = _mm_set_epi16(y1 + 1, y1 + 1, y1, y1, y1 + 1, y1 + 1, y1, y1);
 
+        if (interleaved)
+        {
+            store_si128(&x[i << 5], _mm_unpacklo_epi16(x0_vec, y0_vec), mode);
+            store_si128(&x[(i << 5) + 8], _mm_unpackhi_epi16(x0_vec, y0_vec), mode);
+            store_si128(&x[(i << 5) + 16], _mm_unpacklo_epi16(x1_vec, y1_vec), mode);
+            store_si128(&x[(i << 5) + 24], _mm_unpackhi_epi16(x1_vec, y1_vec), mode);
+            continue;
+        }
+
         // store the values
-        _mm_storeu_si128((__m128i *)&x[idx0], x0_vec);
-        _mm_storeu_si128((__m128i *)&y[idx0], y0_vec);
+        store_si128(&x[i << 4], x0_vec, mode);
+        store_si128(&y[i << 4], y0_vec, mode);
+
+        store_si128(&x[(i << 4) + 8], x1_vec, mode);
+        store_si128(&y[(i << 4) + 8], y1_vec, mode);
+    }
+}
+
+void z_curve_simd_magic(unsigned degree, coord_t *x, coord_t *y)
+{
+    // the kernels store whole vectors, the four points of degree 1 are decoded one by one
+    if (degree == 1)
+    {
+        z_curve_magic(degree, x, y);
+        return;
+    }
+
+    size_t max = 1ull << (degree * 2);
+
+    STORE_MODE_DISPATCH(select_store_mode(degree, x, y), z_curve_simd_magic_kernel, 0, max, x, y, false);
+}
+
+void z_curve_magic_range(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y)
+{
+    (void)degree;
 
-        _mm_storeu_si128((__m128i *)&x[idx1], x1_vec);
-        _mm_storeu_si128((__m128i *)&y[idx1], y1_vec);
+    for (size_t i = 0; i < count; ++i)
+    {
+        decode(start + i, &x[i], &y[i]);
     }
 }
+
+void z_curve_simd_magic_range(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y)
+{
+    // the vector loop needs whole quad'Z's, decode a misaligned head and the tail one by one
+    size_t head = (16 - (start & 15)) & 15;
+    if (head > count)
+    {
+        head = count;
+    }
+
+    z_curve_magic_range(degree, start, head, x, y);
+
+    start += head;
+    count -= head;
+    x += head;
+    y += head;
+
+    size_t body = count & ~(size_t)15;
+
+    if (((uintptr_t)x | (uintptr_t)y) & 0xf)
+    {
+        z_curve_simd_magic_kernel(start, body, x, y, false, STORE_UNALIGNED);
+    }
+    else
+    {
+        z_curve_simd_magic_kernel(start, body, x, y, false, STORE_ALIGNED);
+    }
+
+    z_curve_magic_range(degree, start + body, count - body, x + body, y + body);
+}
+
+void z_curve_magic_aos(unsigned degree, point_t *points)
+{
+    size_t max = 1ull << (degree * 2);
+
+    for (size_t i = 0; i < max; ++i)
+    {
+        decode(i, &points[i].x, &points[i].y);
+    }
+}
+
+void z_curve_magic_keys(unsigned degree, point_key_t *keys)
+{
+    size_t max = 1ull << (degree * 2);
+
+    for (size_t i = 0; i < max; ++i)
+    {
+        coord_t x, y;
+        decode(i, &x, &y);
+        keys[i] = ((point_key_t)y << 16) | x;
+    }
+}
+
+// xy holds 2 * 4^degree interleaved coordinates, at least one quad'Z
+static void z_curve_simd_magic_pairs(unsigned degree, coord_t *xy)
+{
+    size_t max = 1ull << (degree * 2);
+
+    // the pairs take as much memory as both arrays, the store mode is picked the same way
+    STORE_MODE_DISPATCH(select_store_mode(degree, xy, xy), z_curve_simd_magic_kernel, 0, max, xy, NULL, true);
+}
+
+void z_curve_simd_magic_aos(unsigned degree, point_t *points)
+{
+    if (degree < 2)
+    {
+        z_curve_magic_aos(degree, points);
+        return;
+    }
+
+    z_curve_simd_magic_pairs(degree, (coord_t *)points);
+}
+
+void z_curve_simd_magic_keys(unsigned degree, point_key_t *keys)
+{
+    if (degree < 2)
+    {
+        z_curve_magic_keys(degree, keys);
+        return;
+    }
+
+    // a key holds x in its low and y in its high half, exactly the bytes of a pair
+    z_curve_simd_magic_pairs(degree, (coord_t *)keys);
+}
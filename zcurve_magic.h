@@ -8,8 +8,18 @@
 void z_curve_magic(unsigned degree, coord_t *x, coord_t *y);
 void z_curve_magic_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
 size_t z_curve_magic_pos(unsigned degree, coord_t x, coord_t y);
+void z_curve_magic_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y);
+
+void z_curve_magic_range(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y);
+
+// {x, y} pairs and packed (y << 16) | x keys instead of separate arrays
+void z_curve_magic_aos(unsigned degree, point_t *points);
+void z_curve_magic_keys(unsigned degree, point_key_t *keys);
 
 // SIMD Magic
 void z_curve_simd_magic(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_simd_magic_range(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y);
+void z_curve_simd_magic_aos(unsigned degree, point_t *points);
+void z_curve_simd_magic_keys(unsigned degree, point_key_t *keys);
 
 #endif // _ZCURVE_MAGIC_H
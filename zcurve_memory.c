@@ -0,0 +1,132 @@
+#define _GNU_SOURCE
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "zcurve_memory.h"
+
+static inline size_t round_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static void *map_huge(size_t length)
+{
+    // explicit huge pages from the hugetlbfs pool, if the admin reserved any
+    void *ptr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != MAP_FAILED)
+    {
+        return ptr;
+    }
+
+    // otherwise map one extra huge page so we can trim the mapping to a
+    // 2 MiB boundary, which is what transparent huge pages need
+    size_t padded = length + HUGE_PAGE_SIZE;
+    char *raw = mmap(NULL, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    char *aligned = (char *)round_up((uintptr_t)raw, HUGE_PAGE_SIZE);
+    size_t head = aligned - raw;
+    size_t tail = padded - head - length;
+
+    if (head)
+    {
+        munmap(raw, head);
+    }
+
+    if (tail)
+    {
+        munmap(aligned + length, tail);
+    }
+
+    // only a hint: the kernel may have THP disabled
+    madvise(aligned, length, MADV_HUGEPAGE);
+
+    return aligned;
+}
+
+void *z_curve_alloc(size_t size)
+{
+    if (size < HUGE_PAGE_SIZE)
+    {
+        // small buffers are not worth a mapping of their own
+        return aligned_alloc(MEMORY_ALIGNMENT, round_up(size ? size : 1, MEMORY_ALIGNMENT));
+    }
+
+    return map_huge(round_up(size, HUGE_PAGE_SIZE));
+}
+
+void z_curve_free(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+    {
+        return;
+    }
+
+    // the size decides which path z_curve_alloc took
+    if (size < HUGE_PAGE_SIZE)
+    {
+        free(ptr);
+        return;
+    }
+
+    munmap(ptr, round_up(size, HUGE_PAGE_SIZE));
+}
+
+static size_t read_llc_size(void)
+{
+    // sysfs reports the size as e.g. "32768K"
+    FILE *fp = fopen("/sys/devices/system/cpu/cpu0/cache/index3/size", "r");
+    if (fp != NULL)
+    {
+        unsigned long value = 0;
+        char unit = 0;
+        int matched = fscanf(fp, "%lu%c", &value, &unit);
+        fclose(fp);
+
+        if (matched >= 1 && value)
+        {
+            switch (unit)
+            {
+            case 'K':
+                return (size_t)value << 10;
+            case 'M':
+                return (size_t)value << 20;
+            case 'G':
+                return (size_t)value << 30;
+            default:
+                return (size_t)value;
+            }
+        }
+    }
+
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    long size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (size > 0)
+    {
+        return (size_t)size;
+    }
+#endif
+
+    return LLC_SIZE_DEFAULT;
+}
+
+size_t llc_size(void)
+{
+    static atomic_size_t cached = 0;
+
+    size_t size = atomic_load_explicit(&cached, memory_order_relaxed);
+    if (size == 0)
+    {
+        size = read_llc_size();
+        atomic_store_explicit(&cached, size, memory_order_relaxed);
+    }
+
+    return size;
+}
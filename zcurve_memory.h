@@ -0,0 +1,21 @@
+#ifndef _ZCURVE_MEMORY_H
+#define _ZCURVE_MEMORY_H
+
+#include <stdbool.h>
+#include "defs.h"
+
+// alignment of every buffer handed out by z_curve_alloc (one cache line)
+#define MEMORY_ALIGNMENT 64
+
+// size of a transparent huge page on x86-64
+#define HUGE_PAGE_SIZE (2ull << 20)
+
+// fallback if the last level cache size cannot be determined
+#define LLC_SIZE_DEFAULT (8ull << 20)
+
+void *z_curve_alloc(size_t size);
+void z_curve_free(void *ptr, size_t size);
+
+size_t llc_size(void);
+
+#endif // _ZCURVE_MEMORY_H
@@ -1,107 +1,83 @@
 #include "zcurve_multithreading.h"
+#include "zcurve_magic.h"
+#include "zcurve.h"
 
-void *z_curve_thread(void *arg)
+void z_curve_thread(size_t start, size_t end, void *arg)
 {
     // cast the argument to the thread data
     thread_data_t *data = (thread_data_t *)arg;
 
-    for (size_t i = data->start; i < data->end; ++i)
-    {
-        data->x[i] = 0;
-        data->y[i] = 0;
-
-        for (unsigned j = 0; j < data->degree; ++j)
-        {
-            data->x[i] |= ((i >> (j * 2)) & 1ull) << j;
-            data->y[i] |= ((i >> (j * 2 + 1)) & 1ull) << j;
-        }
-    }
-
-    return NULL;
+    // the kernel specialised for the degree
+    z_curve_range(data->degree, start, end - start, &data->x[start], &data->y[start]);
 }
 
-int z_curve_multithreaded(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads)
+void z_curve_batch_thread(size_t start, size_t end, void *arg)
 {
-    size_t max = 1ull << (degree * 2);
+    thread_data_t *data = (thread_data_t *)arg;
 
-    if (num_threads > max)
-    {
-        // who needs more threads than points?
-        num_threads = max;
-    }
+    z_curve_magic_batch_at(&data->idx[start], end - start, &data->x[start], &data->y[start]);
+}
 
-    size_t left_over = max % num_threads;
-    size_t points_per_thread = max / num_threads;
+static void collect_stats(const scheduler_t *scheduler, numa_stats_t *stats)
+{
+    const numa_topology_t *topology = &scheduler->topology;
 
-    pthread_t thread[num_threads];
-    thread_data_t *thread_data = malloc(sizeof(thread_data_t) * num_threads);
+    stats->num_nodes = topology->num_nodes;
 
-    if (thread_data == NULL)
+    for (unsigned n = 0; n < topology->num_nodes; ++n)
     {
-        return -1;
+        stats->node_id[n] = topology->node_id[n];
+        stats->bytes[n] = 0;
+        stats->seconds[n] = 0.0;
     }
 
-    for (unsigned i = 0; i < num_threads; ++i)
+    for (unsigned i = 0; i < scheduler->num_workers; ++i)
     {
-        thread_data_t *data = &thread_data[i];
+        const worker_t *worker = &scheduler->workers[i];
+        unsigned node = numa_node_of_thread(topology, i, scheduler->num_workers);
 
-        data->thread_id = i;
-        data->degree = degree;
-        data->x = x;
-        data->y = y;
+        stats->bytes[node] += worker->processed * sizeof(coord_t) * 2;
 
-        data->start = i * points_per_thread;
-        data->end = data->start + points_per_thread;
-
-        // if its the last thread, give it the left over points
-        if (i == num_threads - 1)
+        // a node is done once its slowest thread is done
+        if (worker->seconds > stats->seconds[node])
         {
-            data->end += left_over;
+            stats->seconds[node] = worker->seconds;
         }
+    }
+}
+
+int z_curve_multithreaded(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads)
+{
+    return z_curve_multithreaded_stats(degree, x, y, num_threads, NULL);
+}
 
-        int result = pthread_create(&thread[i], NULL, z_curve_thread, (void *)data);
+int z_curve_multithreaded_stats(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads, numa_stats_t *stats)
+{
+    size_t max = 1ull << (degree * 2);
 
-        // if the thread cant be created, cancel all threads and return
-        if (result != 0)
-        {
-            for (unsigned j = 0; j < i; ++j)
-            {
-                pthread_cancel(thread[j]);
-            }
-
-            for (unsigned j = 0; j < i; ++j)
-            {
-                pthread_join(thread[j], NULL);
-            }
-
-            free(thread_data);
-            return -1;
-        }
-    }
+    thread_data_t data = {.degree = degree, .idx = NULL, .x = x, .y = y};
+    scheduler_t scheduler;
+
+    int result = parallel_for(&scheduler, max, CHUNK_GRANULARITY, num_threads, z_curve_thread, &data);
 
-    // wait for all threads to finish
-    for (unsigned i = 0; i < num_threads; ++i)
+    if (result == 0 && stats != NULL)
     {
-        int result = pthread_join(thread[i], NULL);
-        if (result != 0)
-        {
-            for (unsigned j = 0; j < num_threads; ++j)
-            {
-                pthread_cancel(thread[j]);
-            }
-
-            for (unsigned j = 0; j < num_threads; ++j)
-            {
-                pthread_join(thread[j], NULL);
-            }
-
-            free(thread_data);
-            return -1;
-        }
+        collect_stats(&scheduler, stats);
     }
 
-    // all threads finished, free the thread data
-    free(thread_data);
+    scheduler_destroy(&scheduler);
+
+    return result;
+}
+
+int z_curve_multithreaded_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y, unsigned num_threads)
+{
+    thread_data_t data = {.idx = idx, .x = x, .y = y};
+    scheduler_t scheduler;
+
+    int result = parallel_for(&scheduler, count, CHUNK_GRANULARITY, num_threads, z_curve_batch_thread, &data);
+
+    scheduler_destroy(&scheduler);
 
-    return 0;
+    return result;
 }
@@ -2,19 +2,28 @@
 #define _ZCURVE_MULTITHREADING_H
 
 #include "defs.h"
+#include "zcurve_numa.h"
+#include "zcurve_scheduler.h"
 #include <pthread.h>
 #include <stdlib.h>
 
 typedef struct
 {
-    unsigned thread_id;
     unsigned degree;
+    const size_t *idx;
     coord_t *x;
     coord_t *y;
-    size_t start;
-    size_t end;
 } thread_data_t;
 
+// keeps chunk boundaries on a 16 point 'quad Z' block, so SIMD kernels can run on whole chunks
+#define CHUNK_GRANULARITY 16
+
+void z_curve_thread(size_t start, size_t end, void *arg);
+void z_curve_batch_thread(size_t start, size_t end, void *arg);
+
 int z_curve_multithreaded(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads);
+int z_curve_multithreaded_stats(unsigned degree, coord_t *x, coord_t *y, unsigned num_threads, numa_stats_t *stats);
+
+int z_curve_multithreaded_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y, unsigned num_threads);
 
 #endif // _ZCURVE_MULTITHREADING_H
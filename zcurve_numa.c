@@ -0,0 +1,150 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "zcurve_numa.h"
+
+#define SYSFS_NODE_PATH "/sys/devices/system/node"
+
+// parses a sysfs cpu/node list like "0-3,8-11" into values, returns the count
+static unsigned parse_list(const char *path, unsigned *values, unsigned max)
+{
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        return 0;
+    }
+
+    unsigned count = 0;
+    unsigned first, last;
+    int c;
+
+    while (fscanf(fp, "%u", &first) == 1)
+    {
+        last = first;
+
+        c = fgetc(fp);
+        if (c == '-')
+        {
+            if (fscanf(fp, "%u", &last) != 1)
+            {
+                break;
+            }
+            c = fgetc(fp);
+        }
+
+        for (unsigned v = first; v <= last && count < max; ++v)
+        {
+            values[count++] = v;
+        }
+
+        if (c != ',')
+        {
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return count;
+}
+
+// drops the cpus the process may not run on (taskset, cgroup cpusets), returns the count left
+static unsigned filter_allowed(const cpu_set_t *allowed, unsigned *cpus, unsigned count)
+{
+    unsigned kept = 0;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (cpus[i] < CPU_SETSIZE && CPU_ISSET(cpus[i], allowed))
+        {
+            cpus[kept++] = cpus[i];
+        }
+    }
+
+    return kept;
+}
+
+void numa_topology_detect(numa_topology_t *topology)
+{
+    unsigned nodes[NUMA_NODES_MAX];
+    unsigned num_nodes = parse_list(SYSFS_NODE_PATH "/online", nodes, NUMA_NODES_MAX);
+
+    // the mask of the calling thread, which the workers inherit
+    cpu_set_t allowed;
+    bool restricted = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+    topology->num_nodes = 0;
+
+    for (unsigned i = 0; i < num_nodes; ++i)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), SYSFS_NODE_PATH "/node%u/cpulist", nodes[i]);
+
+        unsigned n = topology->num_nodes;
+        topology->num_cpus[n] = parse_list(path, topology->cpus[n], NUMA_CPUS_MAX);
+
+        if (restricted)
+        {
+            topology->num_cpus[n] = filter_allowed(&allowed, topology->cpus[n], topology->num_cpus[n]);
+        }
+
+        // memory-only nodes, and nodes we may not run on, cannot run our threads
+        {
+            topology->node_id[n] = nodes[i];
+            topology->num_nodes++;
+        }
+    }
+
+    if (topology->num_nodes)
+    {
+        return;
+    }
+
+    // no sysfs (or no NUMA support, or no allowed cpu on any node): treat the machine as a single node
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned num_cpus = online > 0 ? (unsigned)online : 1;
+
+    topology->num_nodes = 1;
+    topology->node_id[0] = 0;
+    topology->num_cpus[0] = num_cpus < NUMA_CPUS_MAX ? num_cpus : NUMA_CPUS_MAX;
+
+    for (unsigned i = 0; i < topology->num_cpus[0]; ++i)
+    {
+        topology->cpus[0][i] = i;
+    }
+}
+
+unsigned numa_node_of_thread(const numa_topology_t *topology, unsigned thread_id, unsigned num_threads)
+{
+    // consecutive threads share a node, so every node owns one contiguous slice
+    return (unsigned)(((size_t)thread_id * topology->num_nodes) / num_threads);
+}
+
+/*
+the thread may run on any allowed cpu of its node, the kernel balances
+within it. A single node has nothing to place, so nothing is pinned
+*/
+int numa_pin_thread(const numa_topology_t *topology, unsigned thread_id, unsigned num_threads)
+{
+    if (topology->num_nodes < 2)
+    {
+        return 0;
+    }
+
+    unsigned node = numa_node_of_thread(topology, thread_id, num_threads);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (unsigned i = 0; i < topology->num_cpus[node]; ++i)
+    {
+        CPU_SET(topology->cpus[node][i], &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
@@ -0,0 +1,30 @@
+#ifndef _ZCURVE_NUMA_H
+#define _ZCURVE_NUMA_H
+
+#include "defs.h"
+
+#define NUMA_NODES_MAX 8
+#define NUMA_CPUS_MAX 256
+
+typedef struct
+{
+    unsigned num_nodes;
+    unsigned node_id[NUMA_NODES_MAX];
+    unsigned num_cpus[NUMA_NODES_MAX];
+    unsigned cpus[NUMA_NODES_MAX][NUMA_CPUS_MAX];
+} numa_topology_t;
+
+typedef struct
+{
+    unsigned num_nodes;
+    unsigned node_id[NUMA_NODES_MAX];
+    size_t bytes[NUMA_NODES_MAX];
+    double seconds[NUMA_NODES_MAX];
+} numa_stats_t;
+
+void numa_topology_detect(numa_topology_t *topology);
+
+unsigned numa_node_of_thread(const numa_topology_t *topology, unsigned thread_id, unsigned num_threads);
+int numa_pin_thread(const numa_topology_t *topology, unsigned thread_id, unsigned num_threads);
+
+#endif // _ZCURVE_NUMA_H
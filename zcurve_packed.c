@@ -0,0 +1,388 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "zcurve_packed.h"
+#include "zcurve_simd.h"
+#include "zcurve_file.h"
+
+static inline size_t round_up(size_t size, size_t alignment)
+{
+    return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static inline unsigned bit_width(unsigned value)
+{
+    return value ? 32 - __builtin_clz(value) : 0;
+}
+
+static inline size_t block_payload(const packed_block_t *block)
+{
+    return ((size_t)block->width_x + block->width_y) * sizeof(__m128i);
+}
+
+static void pack_block(const coord_t *values, size_t count, coord_t base, unsigned width, uint16_t *out)
+{
+    memset(out, 0, width * sizeof(__m128i));
+
+    for (size_t j = 0; j < count; ++j)
+    {
+        unsigned value = (coord_t)(values[j] - base);
+        unsigned bit = (j >> 3) * width;
+        unsigned word = bit >> 4;
+        unsigned shift = bit & 15;
+        unsigned lane = j & 7;
+
+        out[word * 8 + lane] |= (uint16_t)(value << shift);
+        if (shift + width > 16)
+        {
+            out[(word + 1) * 8 + lane] |= (uint16_t)(value >> (16 - shift));
+        }
+    }
+}
+
+// width is a constant in every instantiation, so shifts and masks become immediates
+static inline __attribute__((always_inline)) void unpack_kernel(const __m128i *in, coord_t base, unsigned width, coord_t *out, store_mode_t mode)
+{
+    const __m128i mask = _mm_set1_epi16((short)((1u << width) - 1));
+    const __m128i offset = _mm_set1_epi16((short)base);
+
+    for (unsigned k = 0; k < PACKED_BLOCK_POINTS / 8; ++k)
+    {
+        __m128i value = _mm_setzero_si128();
+
+        if (width)
+        {
+            unsigned bit = k * width;
+            unsigned word = bit >> 4;
+            unsigned shift = bit & 15;
+
+            value = _mm_srli_epi16(_mm_load_si128(&in[word]), shift);
+            if (shift + width > 16)
+            {
+                value = _mm_or_si128(value, _mm_slli_epi16(_mm_load_si128(&in[word + 1]), 16 - shift));
+            }
+            value = _mm_and_si128(value, mask);
+        }
+
+        store_si128(out + k * 8, _mm_add_epi16(value, offset), mode);
+    }
+}
+
+#define UNPACK_CASE(w, mode)                         \
+    case w:                                          \
+        unpack_kernel(in, base, w, out, mode);       \
+        break;
+
+#define UNPACK_SWITCH(mode)                                                   \
+    switch (width)                                                            \
+    {                                                                         \
+        UNPACK_CASE(0, mode) UNPACK_CASE(1, mode) UNPACK_CASE(2, mode)        \
+        UNPACK_CASE(3, mode) UNPACK_CASE(4, mode) UNPACK_CASE(5, mode)        \
+        UNPACK_CASE(6, mode) UNPACK_CASE(7, mode) UNPACK_CASE(8, mode)        \
+        UNPACK_CASE(9, mode) UNPACK_CASE(10, mode) UNPACK_CASE(11, mode)      \
+        UNPACK_CASE(12, mode) UNPACK_CASE(13, mode) UNPACK_CASE(14, mode)     \
+        UNPACK_CASE(15, mode) UNPACK_CASE(16, mode)                           \
+    }
+
+static void unpack_block(const __m128i *in, coord_t base, unsigned width, coord_t *out, store_mode_t mode)
+{
+    switch (mode)
+    {
+    case STORE_STREAM:
+        UNPACK_SWITCH(STORE_STREAM)
+        break;
+    case STORE_ALIGNED:
+        UNPACK_SWITCH(STORE_ALIGNED)
+        break;
+    default:
+        UNPACK_SWITCH(STORE_UNALIGNED)
+        break;
+    }
+}
+
+static int packed_curve_attach(packed_curve_t *curve, void *image, size_t image_size)
+{
+    if (image_size < sizeof(packed_file_header_t))
+    {
+        return -1;
+    }
+
+    const packed_file_header_t *header = (const packed_file_header_t *)image;
+
+    if (memcmp(header->magic, PACKED_FILE_MAGIC, sizeof(header->magic)) ||
+        header->version != PACKED_FILE_VERSION ||
+        header->coord_width != sizeof(coord_t) ||
+        header->block_points != PACKED_BLOCK_POINTS ||
+        header->degree == 0 || header->degree > DEGREE_MAX ||
+        header->num_points != 1ull << (header->degree * 2) ||
+        header->num_blocks != (header->num_points + PACKED_BLOCK_POINTS - 1) / PACKED_BLOCK_POINTS ||
+        header->blocks_offset % PACKED_FILE_ALIGNMENT || header->blocks_offset < sizeof(*header) ||
+        header->data_offset % PACKED_FILE_ALIGNMENT ||
+        header->data_offset < header->blocks_offset + header->num_blocks * sizeof(packed_block_t) ||
+        header->data_offset + header->data_size > image_size)
+    {
+        return -1;
+    }
+
+    const packed_block_t *blocks = (const packed_block_t *)((const char *)image + header->blocks_offset);
+
+    // the widths decide where every block starts, they have to add up to the payload
+    size_t data_size = 0;
+    for (size_t b = 0; b < header->num_blocks; ++b)
+    {
+        if (blocks[b].width_x > 16 || blocks[b].width_y > 16)
+        {
+            return -1;
+        }
+        data_size += block_payload(&blocks[b]);
+    }
+
+    if (data_size != header->data_size)
+    {
+        return -1;
+    }
+
+    curve->degree = header->degree;
+    curve->num_points = header->num_points;
+    curve->num_blocks = header->num_blocks;
+    curve->checksum = header->checksum;
+    curve->blocks = blocks;
+    curve->data = (const uint8_t *)image + header->data_offset;
+    curve->image = image;
+    curve->image_size = image_size;
+
+    return 0;
+}
+
+int z_curve_packed_encode(packed_curve_t *curve, unsigned degree, const coord_t *x, const coord_t *y)
+{
+    memset(curve, 0, sizeof(*curve));
+
+    size_t num_points = 1ull << (degree * 2);
+    size_t num_blocks = (num_points + PACKED_BLOCK_POINTS - 1) / PACKED_BLOCK_POINTS;
+
+    packed_block_t *blocks = (packed_block_t *)malloc(num_blocks * sizeof(packed_block_t));
+    if (blocks == NULL)
+    {
+        return -1;
+    }
+
+    // first pass sizes every block, so the whole image can be allocated at once
+    size_t data_size = 0;
+    for (size_t b = 0; b < num_blocks; ++b)
+    {
+        size_t start = b * PACKED_BLOCK_POINTS;
+        size_t count = num_points - start < PACKED_BLOCK_POINTS ? num_points - start : PACKED_BLOCK_POINTS;
+
+        coord_t min_x = x[start], max_x = x[start];
+        coord_t min_y = y[start], max_y = y[start];
+        for (size_t i = start + 1; i < start + count; ++i)
+        {
+            min_x = x[i] < min_x ? x[i] : min_x;
+            max_x = x[i] > max_x ? x[i] : max_x;
+            min_y = y[i] < min_y ? y[i] : min_y;
+            max_y = y[i] > max_y ? y[i] : max_y;
+        }
+
+        blocks[b].base_x = min_x;
+        blocks[b].base_y = min_y;
+        blocks[b].width_x = bit_width(max_x - min_x);
+        blocks[b].width_y = bit_width(max_y - min_y);
+        blocks[b].reserved = 0;
+
+        data_size += block_payload(&blocks[b]);
+    }
+
+    size_t blocks_offset = round_up(sizeof(packed_file_header_t), PACKED_FILE_ALIGNMENT);
+    size_t data_offset = round_up(blocks_offset + num_blocks * sizeof(packed_block_t), PACKED_FILE_ALIGNMENT);
+    size_t image_size = round_up(data_offset + data_size, PACKED_FILE_ALIGNMENT);
+
+    char *image = (char *)aligned_alloc(PACKED_FILE_ALIGNMENT, image_size);
+    if (image == NULL)
+    {
+        free(blocks);
+        return -1;
+    }
+
+    memset(image, 0, data_offset);
+
+    packed_file_header_t *header = (packed_file_header_t *)image;
+    memcpy(header->magic, PACKED_FILE_MAGIC, sizeof(header->magic));
+    header->version = PACKED_FILE_VERSION;
+    header->degree = degree;
+    header->coord_width = sizeof(coord_t);
+    header->block_points = PACKED_BLOCK_POINTS;
+    header->num_points = num_points;
+    header->num_blocks = num_blocks;
+    header->blocks_offset = blocks_offset;
+    header->data_offset = data_offset;
+    header->data_size = data_size;
+    header->checksum = (uint64_t)curve_crc32c(0, x, num_points, 1) | ((uint64_t)curve_crc32c(0, y, num_points, 1) << 32);
+
+    memcpy(image + blocks_offset, blocks, num_blocks * sizeof(packed_block_t));
+
+    // second pass packs the offsets to the block minimum
+    uint16_t *out = (uint16_t *)(image + data_offset);
+    for (size_t b = 0; b < num_blocks; ++b)
+    {
+        size_t start = b * PACKED_BLOCK_POINTS;
+        size_t count = num_points - start < PACKED_BLOCK_POINTS ? num_points - start : PACKED_BLOCK_POINTS;
+
+        pack_block(x + start, count, blocks[b].base_x, blocks[b].width_x, out);
+        out += blocks[b].width_x * 8;
+        pack_block(y + start, count, blocks[b].base_y, blocks[b].width_y, out);
+        out += blocks[b].width_y * 8;
+    }
+
+    memset(image + data_offset + data_size, 0, image_size - data_offset - data_size);
+
+    free(blocks);
+
+    if (packed_curve_attach(curve, image, image_size))
+    {
+        free(image);
+        return -1;
+    }
+
+    return 0;
+}
+
+void z_curve_packed_decode(const packed_curve_t *curve, coord_t *x, coord_t *y)
+{
+    store_mode_t mode = select_store_mode(curve->degree, x, y);
+
+    const __m128i *in = (const __m128i *)curve->data;
+    size_t full_blocks = curve->num_points / PACKED_BLOCK_POINTS;
+
+    for (size_t b = 0; b < full_blocks; ++b)
+    {
+        const packed_block_t *block = &curve->blocks[b];
+        size_t start = b * PACKED_BLOCK_POINTS;
+
+        unpack_block(in, block->base_x, block->width_x, x + start, mode);
+        in += block->width_x;
+        unpack_block(in, block->base_y, block->width_y, y + start, mode);
+        in += block->width_y;
+    }
+
+    if (mode == STORE_STREAM)
+    {
+        _mm_sfence();
+    }
+
+    // curves below degree 4 do not fill a single block
+    if (full_blocks < curve->num_blocks)
+    {
+        const packed_block_t *block = &curve->blocks[full_blocks];
+        size_t start = full_blocks * PACKED_BLOCK_POINTS;
+        size_t count = curve->num_points - start;
+
+        _Alignas(16) coord_t tmp[PACKED_BLOCK_POINTS];
+
+        unpack_block(in, block->base_x, block->width_x, tmp, STORE_ALIGNED);
+        memcpy(x + start, tmp, count * sizeof(coord_t));
+        in += block->width_x;
+        unpack_block(in, block->base_y, block->width_y, tmp, STORE_ALIGNED);
+        memcpy(y + start, tmp, count * sizeof(coord_t));
+    }
+}
+
+void z_curve_packed_free(packed_curve_t *curve)
+{
+    if (curve->mapped)
+    {
+        munmap(curve->image, curve->image_size);
+    }
+    else
+    {
+        free(curve->image);
+    }
+
+    memset(curve, 0, sizeof(*curve));
+}
+
+int z_curve_packed_write(const packed_curve_t *curve, const char *filename)
+{
+    FILE *fp = fopen(filename, "wb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Failed to open %s!\n", filename);
+        return -1;
+    }
+
+    int result = fwrite(curve->image, 1, curve->image_size, fp) == curve->image_size ? 0 : -1;
+
+    if (fclose(fp))
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+int z_curve_packed_open(packed_curve_t *curve, const char *filename, bool verify)
+{
+    memset(curve, 0, sizeof(*curve));
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(packed_file_header_t))
+    {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    if (packed_curve_attach(curve, map, st.st_size))
+    {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    curve->mapped = true;
+
+    if (verify)
+    {
+        size_t size = curve->num_points * sizeof(coord_t);
+        coord_t *x = (coord_t *)z_curve_alloc(size);
+        coord_t *y = (coord_t *)z_curve_alloc(size);
+
+        int result = -1;
+        if (x != NULL && y != NULL)
+        {
+            z_curve_packed_decode(curve, x, y);
+
+            uint64_t checksum = (uint64_t)curve_crc32c(0, x, curve->num_points, 1) | ((uint64_t)curve_crc32c(0, y, curve->num_points, 1) << 32);
+            result = checksum == curve->checksum ? 0 : -1;
+        }
+
+        z_curve_free(x, size);
+        z_curve_free(y, size);
+
+        if (result)
+        {
+            z_curve_packed_free(curve);
+            return -1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef _ZCURVE_PACKED_H
+#define _ZCURVE_PACKED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+#define PACKED_FILE_MAGIC "ZCURVEP\n"
+#define PACKED_FILE_VERSION 1
+
+// points per block, 16 per lane of a 128 bit register
+#define PACKED_BLOCK_POINTS 128
+
+// block table and payload start on a cache line
+#define PACKED_FILE_ALIGNMENT 64
+
+#define PACKED_FILE_FILENAME_DEFAULT "zcurve.zcp"
+
+/*
+every block stores its points relative to the smallest coordinate of the
+block, bit-packed with the fewest bits that hold the largest offset. Along
+a Z-curve a block of 128 points covers a 16x8 sub-grid, so this needs 4 + 3
+bits per point no matter the degree, where deltas between consecutive
+points would need extra bits for the jumps at every quadrant border.
+The payload of a block is width_x 128 bit words for x followed by width_y
+words for y. Point j of the block sits in 16 bit lane j % 8 at bit
+(j / 8) * width of that lane, so one shift and mask per register unpacks
+eight consecutive points
+*/
+typedef struct
+{
+    coord_t base_x;
+    coord_t base_y;
+    uint8_t width_x;
+    uint8_t width_y;
+    uint16_t reserved;
+} packed_block_t;
+
+// on-disk header, little endian, the checksum is the one of the curve file format
+typedef struct
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t degree;
+    uint32_t coord_width;
+    uint32_t block_points;
+    uint64_t num_points;
+    uint64_t num_blocks;
+    uint64_t blocks_offset;
+    uint64_t data_offset;
+    uint64_t data_size;
+    uint64_t checksum;
+} packed_file_header_t;
+
+// the encoded curve is kept in memory exactly as it is laid out in the file
+typedef struct
+{
+    unsigned degree;
+    size_t num_points;
+    size_t num_blocks;
+    uint64_t checksum;
+    const packed_block_t *blocks;
+    const uint8_t *data;
+    void *image;
+    size_t image_size;
+    bool mapped;
+} packed_curve_t;
+
+int z_curve_packed_encode(packed_curve_t *curve, unsigned degree, const coord_t *x, const coord_t *y);
+void z_curve_packed_decode(const packed_curve_t *curve, coord_t *x, coord_t *y);
+void z_curve_packed_free(packed_curve_t *curve);
+
+int z_curve_packed_write(const packed_curve_t *curve, const char *filename);
+int z_curve_packed_open(packed_curve_t *curve, const char *filename, bool verify);
+
+#endif // _ZCURVE_PACKED_H
@@ -0,0 +1,186 @@
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "zcurve_memory.h"
+#include "zcurve_pipeline.h"
+
+/*
+the ring follows the sequence number scheme of a bounded MPMC queue:
+slot (b % PIPELINE_RING_SLOTS) carries seq == b while it is free for block b,
+seq == b + 1 once block b is filled, and the writer hands it on to block
+b + PIPELINE_RING_SLOTS after consuming it. Producers claim block numbers
+with a single fetch_add, so nobody ever takes a lock.
+*/
+typedef struct
+{
+    ring_slot_t slots[PIPELINE_RING_SLOTS];
+    atomic_size_t next_block;
+    atomic_bool aborted;
+    size_t num_blocks;
+    size_t max;
+    unsigned degree;
+    block_kernel_t kernel;
+} pipeline_t;
+
+static bool wait_for_seq(pipeline_t *pipeline, ring_slot_t *slot, size_t seq)
+{
+    while (atomic_load_explicit(&slot->seq, memory_order_acquire) != seq)
+    {
+        if (atomic_load_explicit(&pipeline->aborted, memory_order_relaxed))
+        {
+            return false;
+        }
+
+        sched_yield();
+    }
+
+    return true;
+}
+
+static void *producer_thread(void *arg)
+{
+    pipeline_t *pipeline = (pipeline_t *)arg;
+
+    for (;;)
+    {
+        size_t block = atomic_fetch_add_explicit(&pipeline->next_block, 1, memory_order_relaxed);
+        if (block >= pipeline->num_blocks)
+        {
+            break;
+        }
+
+        ring_slot_t *slot = &pipeline->slots[block % PIPELINE_RING_SLOTS];
+
+        // wait until the writer is done with the block that used this slot before
+        if (!wait_for_seq(pipeline, slot, block))
+        {
+            break;
+        }
+
+        slot->start = block * PIPELINE_BLOCK_POINTS;
+        slot->count = pipeline->max - slot->start < PIPELINE_BLOCK_POINTS ? pipeline->max - slot->start : PIPELINE_BLOCK_POINTS;
+
+        pipeline->kernel(pipeline->degree, slot->start, slot->count, slot->x, slot->y);
+
+        atomic_store_explicit(&slot->seq, block + 1, memory_order_release);
+    }
+
+    return NULL;
+}
+
+static int write_blocks(pipeline_t *pipeline, const curve_sink_t *sinks, unsigned num_sinks)
+{
+    for (size_t block = 0; block < pipeline->num_blocks; ++block)
+    {
+        ring_slot_t *slot = &pipeline->slots[block % PIPELINE_RING_SLOTS];
+
+        if (!wait_for_seq(pipeline, slot, block + 1))
+        {
+            return -1;
+        }
+
+        for (unsigned i = 0; i < num_sinks; ++i)
+        {
+            if (sinks[i].write(sinks[i].ctx, slot->x, slot->y, slot->start, slot->count))
+            {
+                return -1;
+            }
+        }
+
+        atomic_store_explicit(&slot->seq, block + PIPELINE_RING_SLOTS, memory_order_release);
+    }
+
+    return 0;
+}
+
+static void end_sinks(const curve_sink_t *sinks, unsigned num_sinks, int *result)
+{
+    for (unsigned i = 0; i < num_sinks; ++i)
+    {
+        if (sinks[i].end(sinks[i].ctx))
+        {
+            *result = -1;
+        }
+    }
+}
+
+int z_curve_pipeline(unsigned degree, block_kernel_t kernel, unsigned num_threads, const curve_sink_t *sinks, unsigned num_sinks)
+{
+    pipeline_t pipeline;
+
+    pipeline.max = 1ull << (degree * 2);
+    pipeline.num_blocks = (pipeline.max + PIPELINE_BLOCK_POINTS - 1) / PIPELINE_BLOCK_POINTS;
+    pipeline.degree = degree;
+    pipeline.kernel = kernel;
+
+    atomic_init(&pipeline.next_block, 0);
+    atomic_init(&pipeline.aborted, false);
+
+    if (num_threads > pipeline.num_blocks)
+    {
+        // who needs more threads than blocks?
+        num_threads = pipeline.num_blocks;
+    }
+
+    // one allocation for every block of the ring
+    size_t block_size = sizeof(coord_t) * PIPELINE_BLOCK_POINTS;
+    size_t buffer_size = block_size * 2 * PIPELINE_RING_SLOTS;
+
+    char *buffer = z_curve_alloc(buffer_size);
+    if (buffer == NULL)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < PIPELINE_RING_SLOTS; ++i)
+    {
+        atomic_init(&pipeline.slots[i].seq, i);
+        pipeline.slots[i].x = (coord_t *)(buffer + block_size * 2 * i);
+        pipeline.slots[i].y = (coord_t *)(buffer + block_size * (2 * i + 1));
+    }
+
+    for (unsigned i = 0; i < num_sinks; ++i)
+    {
+        if (sinks[i].begin(sinks[i].ctx, degree))
+        {
+            int result = -1;
+            end_sinks(sinks, i, &result);
+            z_curve_free(buffer, buffer_size);
+            return result;
+        }
+    }
+
+    pthread_t thread[num_threads];
+    unsigned started = 0;
+
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        // blocks are claimed dynamically, so fewer producers only cost time
+        if (pthread_create(&thread[started], NULL, producer_thread, &pipeline) == 0)
+        {
+            ++started;
+        }
+    }
+
+    // the calling thread becomes the writer
+    int result = started ? write_blocks(&pipeline, sinks, num_sinks) : -1;
+
+    if (result)
+    {
+        // release producers stuck on a full ring
+        atomic_store_explicit(&pipeline.aborted, true, memory_order_relaxed);
+    }
+
+    for (unsigned i = 0; i < started; ++i)
+    {
+        pthread_join(thread[i], NULL);
+    }
+
+    end_sinks(sinks, num_sinks, &result);
+
+    z_curve_free(buffer, buffer_size);
+
+    return result;
+}
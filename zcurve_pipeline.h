@@ -0,0 +1,38 @@
+#ifndef _ZCURVE_PIPELINE_H
+#define _ZCURVE_PIPELINE_H
+
+#include <stdatomic.h>
+
+#include "defs.h"
+
+// points per block handed from the generators to the writer
+#define PIPELINE_BLOCK_POINTS (1ull << 16)
+
+// number of blocks in flight, this bounds the memory of the pipeline
+#define PIPELINE_RING_SLOTS 8
+
+// generates the points [start, start + count) into x[0] and y[0] onwards
+typedef void (*block_kernel_t)(unsigned degree, size_t start, size_t count, coord_t *x, coord_t *y);
+
+// consumer of a curve, blocks arrive in index order
+typedef struct
+{
+    int (*begin)(void *ctx, unsigned degree);
+    int (*write)(void *ctx, const coord_t *x, const coord_t *y, size_t start, size_t count);
+    int (*end)(void *ctx);
+    void *ctx;
+} curve_sink_t;
+
+typedef struct
+{
+    atomic_size_t seq;
+    size_t start;
+    size_t count;
+    coord_t *x;
+    coord_t *y;
+} ring_slot_t;
+
+// every block is handed to all sinks in turn
+int z_curve_pipeline(unsigned degree, block_kernel_t kernel, unsigned num_threads, const curve_sink_t *sinks, unsigned num_sinks);
+
+#endif // _ZCURVE_PIPELINE_H
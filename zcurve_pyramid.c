@@ -0,0 +1,191 @@
+#include <immintrin.h>
+
+#include "zcurve_pyramid.h"
+#include "zcurve_multithreading.h"
+
+typedef struct
+{
+    unsigned degree;
+    pyramid_op_t op;
+    const float *values;
+    float *pyramid;
+} pyramid_data_t;
+
+size_t z_curve_pyramid_size(unsigned degree)
+{
+    return ((1ull << (degree * 2)) - 1) / 3;
+}
+
+float *z_curve_pyramid_level(unsigned degree, unsigned level, float *pyramid)
+{
+    // the finer levels d - 1 down to level + 1 come first
+    return &pyramid[((1ull << (degree * 2)) - (1ull << ((level + 1) * 2))) / 3];
+}
+
+static inline float pyramid_combine(float a, float b, pyramid_op_t op)
+{
+    switch (op)
+    {
+    case PYRAMID_MIN:
+        return a < b ? a : b;
+    case PYRAMID_MAX:
+        return a > b ? a : b;
+    default:
+        return a + b;
+    }
+}
+
+static inline __attribute__((always_inline)) __m128 pyramid_combine_ps(__m128 a, __m128 b, pyramid_op_t op)
+{
+    switch (op)
+    {
+    case PYRAMID_MIN:
+        return _mm_min_ps(a, b);
+    case PYRAMID_MAX:
+        return _mm_max_ps(a, b);
+    default:
+        return _mm_add_ps(a, b);
+    }
+}
+
+/*
+four groups of four children per step: after the transpose row k holds
+the k-th child of every group, so combining the rows reduces all four
+groups at once. The mean of means is the mean, every group has the same
+weight, so mean is the sum scaled by 1/4 on every level
+*/
+static inline __attribute__((always_inline)) void pyramid_reduce_kernel(const float *src, float *dst, size_t groups, pyramid_op_t op)
+{
+    size_t g = 0;
+
+    for (; g + 4 <= groups; g += 4)
+    {
+        __m128 r0 = _mm_loadu_ps(&src[g * 4]);
+        __m128 r1 = _mm_loadu_ps(&src[g * 4 + 4]);
+        __m128 r2 = _mm_loadu_ps(&src[g * 4 + 8]);
+        __m128 r3 = _mm_loadu_ps(&src[g * 4 + 12]);
+
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        __m128 result = pyramid_combine_ps(pyramid_combine_ps(r0, r1, op), pyramid_combine_ps(r2, r3, op), op);
+
+        if (op == PYRAMID_MEAN)
+        {
+            result = _mm_mul_ps(result, _mm_set1_ps(0.25f));
+        }
+
+        _mm_storeu_ps(&dst[g], result);
+    }
+
+    // the coarsest levels have fewer than four cells
+    for (; g < groups; ++g)
+    {
+        const float *c = &src[g * 4];
+        float result = pyramid_combine(pyramid_combine(c[0], c[1], op), pyramid_combine(c[2], c[3], op), op);
+
+        dst[g] = op == PYRAMID_MEAN ? result * 0.25f : result;
+    }
+}
+
+// the operation is a constant inside every copy of the kernel
+static void pyramid_reduce(const float *src, float *dst, size_t groups, pyramid_op_t op)
+{
+    switch (op)
+    {
+    case PYRAMID_MIN:
+        pyramid_reduce_kernel(src, dst, groups, PYRAMID_MIN);
+        break;
+    case PYRAMID_MAX:
+        pyramid_reduce_kernel(src, dst, groups, PYRAMID_MAX);
+        break;
+    case PYRAMID_MEAN:
+        pyramid_reduce_kernel(src, dst, groups, PYRAMID_MEAN);
+        break;
+    default:
+        pyramid_reduce_kernel(src, dst, groups, PYRAMID_SUM);
+        break;
+    }
+}
+
+// reduces count cells of level from, starting at cell start, up through the levels below it down to level to
+static void pyramid_levels(unsigned degree, unsigned from, unsigned to, size_t start, size_t count, const float *src, float *pyramid, pyramid_op_t op)
+{
+    for (unsigned level = from; level-- > to;)
+    {
+        start >>= 2;
+        count >>= 2;
+
+        float *dst = z_curve_pyramid_level(degree, level, pyramid) + start;
+        pyramid_reduce(src, dst, count, op);
+        src = dst;
+    }
+}
+
+/*
+every block of points goes through all the levels it covers before the
+next one is loaded, so the values are read exactly once and the finer
+levels are read back from L1 instead of memory
+*/
+static void pyramid_blocks(const pyramid_data_t *data, size_t start, size_t end)
+{
+    unsigned degree = data->degree;
+
+    for (size_t block = start; block < end; block += PYRAMID_BLOCK_POINTS)
+    {
+        pyramid_levels(degree, degree, degree - PYRAMID_BLOCK_DEGREE, block, PYRAMID_BLOCK_POINTS, &data->values[block], data->pyramid, data->op);
+    }
+}
+
+// the levels above the blocks only have 4^(d - PYRAMID_BLOCK_DEGREE) cells left
+static void pyramid_top(const pyramid_data_t *data)
+{
+    unsigned degree = data->degree;
+    unsigned from = degree - PYRAMID_BLOCK_DEGREE;
+
+    pyramid_levels(degree, from, 0, 0, 1ull << (from * 2), z_curve_pyramid_level(degree, from, data->pyramid), data->pyramid, data->op);
+}
+
+void z_curve_pyramid(unsigned degree, const float *values, float *pyramid, pyramid_op_t op)
+{
+    if (degree <= PYRAMID_BLOCK_DEGREE)
+    {
+        pyramid_levels(degree, degree, 0, 0, 1ull << (degree * 2), values, pyramid, op);
+        return;
+    }
+
+    pyramid_data_t data = {.degree = degree, .op = op, .values = values, .pyramid = pyramid};
+
+    pyramid_blocks(&data, 0, 1ull << (degree * 2));
+    pyramid_top(&data);
+}
+
+static void z_curve_pyramid_thread(size_t start, size_t end, void *arg)
+{
+    pyramid_blocks((const pyramid_data_t *)arg, start, end);
+}
+
+int z_curve_pyramid_multithreaded(unsigned degree, const float *values, float *pyramid, pyramid_op_t op, unsigned num_threads)
+{
+    if (degree <= PYRAMID_BLOCK_DEGREE)
+    {
+        z_curve_pyramid(degree, values, pyramid, op);
+        return 0;
+    }
+
+    pyramid_data_t data = {.degree = degree, .op = op, .values = values, .pyramid = pyramid};
+    scheduler_t scheduler;
+
+    // chunks are whole blocks, so no block is split between two workers
+    int result = parallel_for(&scheduler, 1ull << (degree * 2), PYRAMID_BLOCK_POINTS, num_threads, z_curve_pyramid_thread, &data);
+
+    scheduler_destroy(&scheduler);
+
+    if (result)
+    {
+        return -1;
+    }
+
+    pyramid_top(&data);
+
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef _ZCURVE_PYRAMID_H
+#define _ZCURVE_PYRAMID_H
+
+#include "defs.h"
+
+// blocks of 4^6 points are reduced through every level they cover while they are still in L1
+#define PYRAMID_BLOCK_DEGREE 6
+#define PYRAMID_BLOCK_POINTS (1u << (PYRAMID_BLOCK_DEGREE * 2))
+
+typedef enum
+{
+    PYRAMID_SUM,
+    PYRAMID_MIN,
+    PYRAMID_MAX,
+    PYRAMID_MEAN,
+    PYRAMID_MAX_OP
+} pyramid_op_t;
+
+#define PYRAMID_OP_DEFAULT PYRAMID_MEAN
+
+static inline const char *pyramid_op_to_string(pyramid_op_t op)
+{
+    switch (op)
+    {
+    case PYRAMID_SUM:
+        return "sum";
+    case PYRAMID_MIN:
+        return "min";
+    case PYRAMID_MAX:
+        return "max";
+    case PYRAMID_MEAN:
+        return "mean";
+    default:
+        return "UNKNOWN";
+    }
+}
+
+/*
+multi-resolution pyramid over per-point values in Z order: the parent of
+index i one level up is i >> 2, so the four children of a cell are always
+next to each other and every level is a reduction of groups of four.
+The levels d - 1 down to 0 are stored finest first, level l holds 4^l
+cells and the whole pyramid z_curve_pyramid_size(d) = (4^d - 1) / 3
+*/
+size_t z_curve_pyramid_size(unsigned degree);
+float *z_curve_pyramid_level(unsigned degree, unsigned level, float *pyramid);
+
+void z_curve_pyramid(unsigned degree, const float *values, float *pyramid, pyramid_op_t op);
+int z_curve_pyramid_multithreaded(unsigned degree, const float *values, float *pyramid, pyramid_op_t op, unsigned num_threads);
+
+#endif // _ZCURVE_PYRAMID_H
@@ -0,0 +1,255 @@
+#include <stdlib.h>
+
+#include "zcurve_quadtree.h"
+#include "zcurve_codec.h"
+
+typedef struct
+{
+    coord_t x0;
+    coord_t y0;
+    coord_t x1;
+    coord_t y1;
+} quadtree_rect_t;
+
+static inline unsigned cell_shift(const z_quadtree_t *tree, unsigned level)
+{
+    return (tree->degree - level) * 2;
+}
+
+// the coarsest level at which a and b no longer share a cell, a != b
+static inline unsigned split_level(unsigned degree, size_t a, size_t b)
+{
+    unsigned msb = 63 - __builtin_clzll((unsigned long long)(a ^ b));
+    return degree - msb / 2;
+}
+
+// first position in [begin, end) whose key is not below key
+static size_t lower_bound(const size_t *keys, size_t begin, size_t end, size_t key)
+{
+    while (begin < end)
+    {
+        size_t mid = begin + (end - begin) / 2;
+
+        if (keys[mid] < key)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+
+    return begin;
+}
+
+/*
+one pass over the keys, one step per leaf: a leaf starting at key k
+can be no coarser than the first level that separates k from the last
+key of the previous leaf, and no coarser than the first level that
+separates k from the key capacity positions further on, which would be
+one point too many
+*/
+int z_quadtree_build(z_quadtree_t *tree, unsigned degree, const size_t *keys, size_t count, size_t capacity)
+{
+    tree->degree = degree;
+    tree->capacity = capacity ? capacity : 1;
+    tree->keys = keys;
+    tree->num_keys = count;
+    tree->num_leaves = 0;
+
+    size_t reserved = count / tree->capacity + 1;
+    tree->leaves = (quadtree_cell_t *)malloc(sizeof(quadtree_cell_t) * reserved);
+    if (tree->leaves == NULL)
+    {
+        return -1;
+    }
+
+    for (size_t i = 0; i < count;)
+    {
+        size_t key = keys[i];
+        unsigned level = i ? split_level(degree, keys[i - 1], key) : 0;
+
+        if (i + tree->capacity < count)
+        {
+            size_t next = keys[i + tree->capacity];
+            unsigned full = next == key ? degree : split_level(degree, key, next);
+
+            level = full > level ? full : level;
+        }
+
+        unsigned shift = cell_shift(tree, level);
+        size_t prefix = key >> shift;
+
+        // at most capacity steps, only repeated keys in a single point cell go on
+        size_t end = i + 1;
+        while (end < count && (keys[end] >> shift) == prefix)
+        {
+            ++end;
+        }
+
+        if (tree->num_leaves == reserved)
+        {
+            reserved *= 2;
+            quadtree_cell_t *leaves = (quadtree_cell_t *)realloc(tree->leaves, sizeof(quadtree_cell_t) * reserved);
+            if (leaves == NULL)
+            {
+                z_quadtree_destroy(tree);
+                return -1;
+            }
+            tree->leaves = leaves;
+        }
+
+        tree->leaves[tree->num_leaves++] = (quadtree_cell_t){.level = level, .prefix = prefix, .begin = i, .end = end};
+        i = end;
+    }
+
+    return 0;
+}
+
+void z_quadtree_destroy(z_quadtree_t *tree)
+{
+    free(tree->leaves);
+    tree->leaves = NULL;
+    tree->num_leaves = 0;
+}
+
+size_t z_quadtree_locate(const z_quadtree_t *tree, coord_t x, coord_t y)
+{
+    size_t key = encode(x, y);
+
+    // last leaf starting at or before the key
+    size_t begin = 0, end = tree->num_leaves;
+    while (begin < end)
+    {
+        size_t mid = begin + (end - begin) / 2;
+        const quadtree_cell_t *leaf = &tree->leaves[mid];
+
+        if ((leaf->prefix << cell_shift(tree, leaf->level)) <= key)
+        {
+            begin = mid + 1;
+        }
+        else
+        {
+            end = mid;
+        }
+    }
+
+    if (begin == 0)
+    {
+        return QUADTREE_NONE;
+    }
+
+    const quadtree_cell_t *leaf = &tree->leaves[begin - 1];
+
+    return (key >> cell_shift(tree, leaf->level)) == leaf->prefix ? begin - 1 : QUADTREE_NONE;
+}
+
+/*
+cells outside the rectangle count nothing and cells inside count all
+their keys [begin, end). Only cells on its border are split, and once a
+cell is down to a leaf's worth of points they are tested one by one
+*/
+static size_t count_cell(const z_quadtree_t *tree, unsigned level, size_t prefix, size_t begin, size_t end, const quadtree_rect_t *rect)
+{
+    if (begin == end)
+    {
+        return 0;
+    }
+
+    unsigned shift = cell_shift(tree, level);
+    size_t size = 1ull << (tree->degree - level);
+
+    coord_t cx, cy;
+    decode(prefix << shift, &cx, &cy);
+
+    size_t last_x = cx + size - 1;
+    size_t last_y = cy + size - 1;
+
+    if (last_x < rect->x0 || cx > rect->x1 || last_y < rect->y0 || cy > rect->y1)
+    {
+        return 0;
+    }
+
+    if (cx >= rect->x0 && last_x <= rect->x1 && cy >= rect->y0 && last_y <= rect->y1)
+    {
+        return end - begin;
+    }
+
+    if (end - begin <= tree->capacity || level == tree->degree)
+    {
+        size_t inside = 0;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            coord_t x, y;
+            decode(tree->keys[i], &x, &y);
+
+            inside += x >= rect->x0 && x <= rect->x1 && y >= rect->y0 && y <= rect->y1;
+        }
+
+        return inside;
+    }
+
+    size_t result = 0;
+    size_t child_begin = begin;
+
+    for (size_t child = 0; child < 4; ++child)
+    {
+        size_t child_prefix = (prefix << 2) | child;
+        size_t child_end = child == 3 ? end : lower_bound(tree->keys, child_begin, end, (child_prefix + 1) << (shift - 2));
+
+        result += count_cell(tree, level + 1, child_prefix, child_begin, child_end, rect);
+        child_begin = child_end;
+    }
+
+    return result;
+}
+
+size_t z_quadtree_count(const z_quadtree_t *tree, coord_t x0, coord_t y0, coord_t x1, coord_t y1)
+{
+    if (x0 > x1 || y0 > y1)
+    {
+        return 0;
+    }
+
+    quadtree_rect_t rect = {.x0 = x0, .y0 = y0, .x1 = x1, .y1 = y1};
+
+    return count_cell(tree, 0, 0, 0, tree->num_keys, &rect);
+}
+
+void z_quadtree_level_begin(z_quadtree_iter_t *iter, const z_quadtree_t *tree, unsigned level)
+{
+    iter->tree = tree;
+    iter->level = level;
+    iter->next = 0;
+}
+
+bool z_quadtree_level_next(z_quadtree_iter_t *iter, quadtree_cell_t *cell)
+{
+    const z_quadtree_t *tree = iter->tree;
+    size_t begin = iter->next;
+
+    if (begin >= tree->num_keys)
+    {
+        return false;
+    }
+
+    unsigned shift = cell_shift(tree, iter->level);
+    size_t prefix = tree->keys[begin] >> shift;
+    size_t bound = (prefix + 1) << shift;
+
+    // gallop to the end of the cell, fine levels end after a few keys and coarse ones after many
+    size_t step = 1;
+    while (begin + step < tree->num_keys && tree->keys[begin + step] < bound)
+    {
+        step *= 2;
+    }
+
+    size_t end = lower_bound(tree->keys, begin + step / 2, begin + step < tree->num_keys ? begin + step : tree->num_keys, bound);
+
+    *cell = (quadtree_cell_t){.level = iter->level, .prefix = prefix, .begin = begin, .end = end};
+    iter->next = end;
+
+    return true;
+}
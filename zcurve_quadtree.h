@@ -0,0 +1,61 @@
+#ifndef _ZCURVE_QUADTREE_H
+#define _ZCURVE_QUADTREE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+#define QUADTREE_NONE SIZE_MAX
+
+/*
+a cell is identified by its level, 0 is the whole plane and d a single
+point, and its key prefix: the cell at level l holding key k is
+k >> 2(d - l), and its points are the keys [begin, end)
+*/
+typedef struct
+{
+    unsigned level;
+    size_t prefix;
+    size_t begin;
+    size_t end;
+} quadtree_cell_t;
+
+/*
+linear quadtree over a sorted array of Z keys, which it only borrows:
+the leaves are the largest cells holding at most capacity points (cells
+of a single point may hold more if keys repeat), stored in Z order.
+Empty cells are never stored, so the leaves cover the keys but not
+necessarily the plane
+*/
+typedef struct
+{
+    unsigned degree;
+    size_t capacity;
+    const size_t *keys;
+    size_t num_keys;
+    quadtree_cell_t *leaves;
+    size_t num_leaves;
+} z_quadtree_t;
+
+typedef struct
+{
+    const z_quadtree_t *tree;
+    unsigned level;
+    size_t next;
+} z_quadtree_iter_t;
+
+int z_quadtree_build(z_quadtree_t *tree, unsigned degree, const size_t *keys, size_t count, size_t capacity);
+void z_quadtree_destroy(z_quadtree_t *tree);
+
+// index of the leaf holding (x, y), QUADTREE_NONE where there are no points
+size_t z_quadtree_locate(const z_quadtree_t *tree, coord_t x, coord_t y);
+
+// number of points in the rectangle [x0, x1] x [y0, y1]
+size_t z_quadtree_count(const z_quadtree_t *tree, coord_t x0, coord_t y0, coord_t x1, coord_t y1);
+
+// the non-empty cells of one level in Z order
+void z_quadtree_level_begin(z_quadtree_iter_t *iter, const z_quadtree_t *tree, unsigned level);
+bool z_quadtree_level_next(z_quadtree_iter_t *iter, quadtree_cell_t *cell);
+
+#endif // _ZCURVE_QUADTREE_H
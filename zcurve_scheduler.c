@@ -0,0 +1,327 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdlib.h>
+#include <time.h>
+
+#include "zcurve_scheduler.h"
+
+static inline uint64_t pack_range(uint32_t head, uint32_t tail)
+{
+    return ((uint64_t)head << 32) | tail;
+}
+
+static inline uint32_t range_head(uint64_t range)
+{
+    return (uint32_t)(range >> 32);
+}
+
+static inline uint32_t range_tail(uint64_t range)
+{
+    return (uint32_t)range;
+}
+
+static int pop_chunk(worker_t *worker, size_t *chunk)
+{
+    uint64_t range = atomic_load_explicit(&worker->range, memory_order_acquire);
+
+    while (range_head(range) < range_tail(range))
+    {
+        uint64_t next = pack_range(range_head(range) + 1, range_tail(range));
+
+        if (atomic_compare_exchange_weak_explicit(&worker->range, &range, next, memory_order_acq_rel, memory_order_acquire))
+        {
+            *chunk = range_head(range);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static int steal_from(scheduler_t *scheduler, unsigned thief, unsigned victim_id)
+{
+    worker_t *victim = &scheduler->workers[victim_id];
+    uint64_t range = atomic_load_explicit(&victim->range, memory_order_acquire);
+
+    while (range_head(range) < range_tail(range))
+    {
+        uint32_t head = range_head(range);
+        uint32_t tail = range_tail(range);
+
+        // take the upper half, rounded up so a single chunk can be stolen
+        uint32_t split = tail - ((tail - head + 1) >> 1);
+
+        if (atomic_compare_exchange_weak_explicit(&victim->range, &range, pack_range(head, split), memory_order_acq_rel, memory_order_acquire))
+        {
+            // our deque is empty, so nobody else can be modifying it
+            atomic_store_explicit(&scheduler->workers[thief].range, pack_range(split, tail), memory_order_release);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+victims on our own node first: a stolen chunk is first-touched by the
+thief, so taking one from another node places its pages there. Only
+once every deque of our node is empty do we steal across nodes
+*/
+static int steal_chunks(scheduler_t *scheduler, unsigned thief)
+{
+    const numa_topology_t *topology = &scheduler->topology;
+    unsigned node = numa_node_of_thread(topology, thief, scheduler->num_workers);
+
+    for (int local = 1; local >= 0; --local)
+    {
+        // start with the next worker, so thieves spread out over the victims
+        for (unsigned i = 1; i < scheduler->num_workers; ++i)
+        {
+            unsigned victim = (thief + i) % scheduler->num_workers;
+
+            if ((numa_node_of_thread(topology, victim, scheduler->num_workers) == node) != local)
+            {
+                continue;
+            }
+
+            if (steal_from(scheduler, thief, victim))
+            {
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void *worker_thread(void *arg)
+{
+    worker_arg_t *worker_arg = (worker_arg_t *)arg;
+    scheduler_t *scheduler = (scheduler_t *)worker_arg->scheduler;
+    unsigned id = worker_arg->worker_id;
+    worker_t *self = &scheduler->workers[id];
+
+    // pin before the first store, so the pages of our slice are first-touched
+    // (and therefore allocated) on the node this thread runs on
+    numa_pin_thread(&scheduler->topology, id, scheduler->num_workers);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (!atomic_load_explicit(&scheduler->cancelled, memory_order_relaxed))
+    {
+        size_t chunk;
+
+        if (!pop_chunk(self, &chunk))
+        {
+            // work is only ever moved, never added: once every deque
+            // looked empty there is nothing left for us to do
+            if (!steal_chunks(scheduler, id))
+            {
+                break;
+            }
+            continue;
+        }
+
+        size_t first = chunk * scheduler->chunk_size;
+        size_t last = first + scheduler->chunk_size;
+
+        if (last > scheduler->count)
+        {
+            last = scheduler->count;
+        }
+
+        scheduler->fn(first, last, scheduler->arg);
+        self->processed += last - first;
+
+        // publish the chunk, so readers of the finished prefix see its data
+        atomic_store_explicit(&scheduler->chunk_done[chunk], 1, memory_order_release);
+        atomic_fetch_add_explicit(&scheduler->completed, last - first, memory_order_relaxed);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    self->seconds = end.tv_sec - start.tv_sec + 1e-9 * (end.tv_nsec - start.tv_nsec);
+
+    atomic_fetch_sub_explicit(&scheduler->active, 1, memory_order_release);
+
+    return NULL;
+}
+
+static size_t select_chunk_size(size_t count, size_t granularity, unsigned num_threads)
+{
+    size_t chunk_size = count / ((size_t)num_threads * SCHEDULER_CHUNKS_PER_WORKER);
+
+    if (chunk_size < SCHEDULER_CHUNK_MIN)
+    {
+        chunk_size = SCHEDULER_CHUNK_MIN;
+    }
+
+    // chunks must start on a vector boundary for the SIMD kernels
+    return (chunk_size + granularity - 1) / granularity * granularity;
+}
+
+static int start_workers(scheduler_t *scheduler, size_t count, size_t chunk_size, unsigned num_threads, range_fn_t fn, void *arg)
+{
+    scheduler->fn = fn;
+    scheduler->arg = arg;
+    scheduler->count = count;
+    scheduler->chunk_size = chunk_size ? chunk_size : 1;
+    scheduler->num_chunks = (count + scheduler->chunk_size - 1) / scheduler->chunk_size;
+    scheduler->started = 0;
+
+    if (num_threads > scheduler->num_chunks)
+    {
+        // who needs more threads than chunks?
+        num_threads = scheduler->num_chunks ? scheduler->num_chunks : 1;
+    }
+
+    scheduler->num_workers = num_threads;
+    numa_topology_detect(&scheduler->topology);
+
+    atomic_init(&scheduler->cancelled, false);
+    atomic_init(&scheduler->active, num_threads);
+    atomic_init(&scheduler->completed, 0);
+    atomic_init(&scheduler->prefix_chunks, 0);
+
+    scheduler->workers = aligned_alloc(_Alignof(worker_t), sizeof(worker_t) * num_threads);
+    scheduler->worker_args = malloc(sizeof(worker_arg_t) * num_threads);
+    scheduler->threads = malloc(sizeof(pthread_t) * num_threads);
+    scheduler->chunk_done = calloc(scheduler->num_chunks + 1, sizeof(atomic_uchar));
+
+    if (scheduler->workers == NULL || scheduler->worker_args == NULL || scheduler->threads == NULL || scheduler->chunk_done == NULL)
+    {
+        return -1;
+    }
+
+    // seed every deque with a contiguous slice, like the static split did
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        uint32_t head = (uint32_t)(scheduler->num_chunks * i / num_threads);
+        uint32_t tail = (uint32_t)(scheduler->num_chunks * (i + 1) / num_threads);
+
+        atomic_init(&scheduler->workers[i].range, pack_range(head, tail));
+        scheduler->workers[i].processed = 0;
+        scheduler->workers[i].seconds = 0.0;
+
+        scheduler->worker_args[i].scheduler = scheduler;
+        scheduler->worker_args[i].worker_id = i;
+    }
+
+    for (unsigned i = 0; i < num_threads; ++i)
+    {
+        // a worker that fails to start simply gets its slice stolen
+        if (pthread_create(&scheduler->threads[scheduler->started], NULL, worker_thread, &scheduler->worker_args[i]) == 0)
+        {
+            ++scheduler->started;
+        }
+        else
+        {
+            atomic_fetch_sub_explicit(&scheduler->active, 1, memory_order_relaxed);
+        }
+    }
+
+    return scheduler->started ? 0 : -1;
+}
+
+int scheduler_start(scheduler_t *scheduler, size_t count, size_t granularity, unsigned num_threads, range_fn_t fn, void *arg)
+{
+    return start_workers(scheduler, count, select_chunk_size(count, granularity ? granularity : 1, num_threads), num_threads, fn, arg);
+}
+
+int scheduler_wait(scheduler_t *scheduler)
+{
+    int result = 0;
+
+    for (unsigned i = 0; i < scheduler->started; ++i)
+    {
+        if (pthread_join(scheduler->threads[i], NULL) != 0)
+        {
+            result = -1;
+        }
+    }
+
+    scheduler->started = 0;
+
+    if (atomic_load_explicit(&scheduler->completed, memory_order_relaxed) != scheduler->count)
+    {
+        // cancelled before every chunk ran
+        result = -1;
+    }
+
+    return result;
+}
+
+void scheduler_cancel(scheduler_t *scheduler)
+{
+    // workers finish the chunk they are on and then exit
+    atomic_store_explicit(&scheduler->cancelled, true, memory_order_relaxed);
+}
+
+bool scheduler_running(scheduler_t *scheduler)
+{
+    return atomic_load_explicit(&scheduler->active, memory_order_acquire) != 0;
+}
+
+size_t scheduler_progress(scheduler_t *scheduler)
+{
+    return atomic_load_explicit(&scheduler->completed, memory_order_relaxed);
+}
+
+size_t scheduler_prefix(scheduler_t *scheduler)
+{
+    size_t prefix = atomic_load_explicit(&scheduler->prefix_chunks, memory_order_relaxed);
+    size_t start = prefix;
+
+    // chunks finish out of order, extend the prefix over every finished one
+    while (prefix < scheduler->num_chunks && atomic_load_explicit(&scheduler->chunk_done[prefix], memory_order_acquire))
+    {
+        ++prefix;
+    }
+
+    if (prefix != start)
+    {
+        // concurrent pollers may race here, the prefix only ever grows
+        size_t expected = start;
+        while (expected < prefix && !atomic_compare_exchange_weak_explicit(&scheduler->prefix_chunks, &expected, prefix, memory_order_relaxed, memory_order_relaxed))
+        {
+        }
+    }
+
+    size_t points = prefix * scheduler->chunk_size;
+
+    return points < scheduler->count ? points : scheduler->count;
+}
+
+int parallel_for(scheduler_t *scheduler, size_t count, size_t granularity, unsigned num_threads, range_fn_t fn, void *arg)
+{
+    if (scheduler_start(scheduler, count, granularity, num_threads, fn, arg))
+    {
+        scheduler_wait(scheduler);
+        return -1;
+    }
+
+    return scheduler_wait(scheduler);
+}
+
+int parallel_for_chunks(scheduler_t *scheduler, size_t count, size_t chunk_size, unsigned num_threads, range_fn_t fn, void *arg)
+{
+    if (start_workers(scheduler, count, chunk_size, num_threads, fn, arg))
+    {
+        scheduler_wait(scheduler);
+        return -1;
+    }
+
+    return scheduler_wait(scheduler);
+}
+
+void scheduler_destroy(scheduler_t *scheduler)
+{
+    free(scheduler->workers);
+    free(scheduler->worker_args);
+    free(scheduler->threads);
+    free((void *)scheduler->chunk_done);
+
+    scheduler->workers = NULL;
+    scheduler->worker_args = NULL;
+    scheduler->threads = NULL;
+    scheduler->chunk_done = NULL;
+}
@@ -0,0 +1,75 @@
+#ifndef _ZCURVE_SCHEDULER_H
+#define _ZCURVE_SCHEDULER_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "defs.h"
+#include "zcurve_numa.h"
+
+// target number of chunks per worker, enough to balance uneven kernels
+#define SCHEDULER_CHUNKS_PER_WORKER 64
+
+// never hand out chunks smaller than this many items
+#define SCHEDULER_CHUNK_MIN 4096
+
+typedef void (*range_fn_t)(size_t start, size_t end, void *arg);
+
+/*
+every worker owns a deque of chunk indices [head, tail), packed into one
+64 bit word so that both ends can be claimed with a single CAS:
+the owner pops from the head and walks its slice front to back, thieves
+take the upper half from the tail
+*/
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t range;
+    size_t processed;
+    double seconds;
+} worker_t;
+
+typedef struct
+{
+    void *scheduler;
+    unsigned worker_id;
+} worker_arg_t;
+
+typedef struct
+{
+    range_fn_t fn;
+    void *arg;
+    size_t count;
+    size_t chunk_size;
+    size_t num_chunks;
+    unsigned num_workers;
+    unsigned started;
+    numa_topology_t topology;
+    worker_t *workers;
+    worker_arg_t *worker_args;
+    pthread_t *threads;
+
+    // progress reporting and cancellation for asynchronous callers
+    atomic_bool cancelled;
+    atomic_uint active;
+    atomic_size_t completed;
+    atomic_size_t prefix_chunks;
+    atomic_uchar *chunk_done;
+} scheduler_t;
+
+int scheduler_start(scheduler_t *scheduler, size_t count, size_t granularity, unsigned num_threads, range_fn_t fn, void *arg);
+int scheduler_wait(scheduler_t *scheduler);
+void scheduler_cancel(scheduler_t *scheduler);
+void scheduler_destroy(scheduler_t *scheduler);
+
+bool scheduler_running(scheduler_t *scheduler);
+size_t scheduler_progress(scheduler_t *scheduler);
+size_t scheduler_prefix(scheduler_t *scheduler);
+
+int parallel_for(scheduler_t *scheduler, size_t count, size_t granularity, unsigned num_threads, range_fn_t fn, void *arg);
+
+// like parallel_for, but with a fixed chunk size for few, expensive items
+int parallel_for_chunks(scheduler_t *scheduler, size_t count, size_t chunk_size, unsigned num_threads, range_fn_t fn, void *arg);
+
+#endif // _ZCURVE_SCHEDULER_H
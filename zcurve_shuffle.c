@@ -0,0 +1,300 @@
+#include <string.h>
+
+#include "zcurve_shuffle.h"
+#include "zcurve_simd.h"
+
+/*
+decode tables: the even (x) and odd (y) bits of a nibble, compacted.
+encode table: a nibble with its bits moved to the even positions of a byte
+*/
+#define NIBBLE_X 0, 1, 0, 1, 2, 3, 2, 3, 0, 1, 0, 1, 2, 3, 2, 3
+#define NIBBLE_Y 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 3, 3, 2, 2, 3, 3
+#define NIBBLE_DILATE 0x00, 0x01, 0x04, 0x05, 0x10, 0x11, 0x14, 0x15, 0x40, 0x41, 0x44, 0x45, 0x50, 0x51, 0x54, 0x55
+
+/*
+four 32 bit indices to their coordinates in 32 bit lanes: both nibbles of
+every byte are looked up, which leaves 4 bits of x and y per byte. maddubs
+merges byte pairs with the weights 1 and 16, madd merges the resulting
+words with 1 and 256
+*/
+static inline __m128i decode_lanes_sse(__m128i idx, __m128i table)
+{
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+
+    __m128i low = _mm_and_si128(idx, nibble_mask);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(idx, 4), nibble_mask);
+
+    // values stay below 16, the 16 bit shift never carries into the next byte
+    __m128i bytes = _mm_or_si128(_mm_shuffle_epi8(table, low), _mm_slli_epi16(_mm_shuffle_epi8(table, high), 2));
+
+    __m128i words = _mm_maddubs_epi16(bytes, _mm_set1_epi16(0x1001));
+    return _mm_madd_epi16(words, _mm_set1_epi32(0x01000001));
+}
+
+// eight 16 bit coordinates to their dilated values in two registers of 32 bit lanes
+static inline void dilate_lanes_sse(__m128i value, __m128i *low_half, __m128i *high_half)
+{
+    const __m128i table = _mm_setr_epi8(NIBBLE_DILATE);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0f);
+
+    __m128i low = _mm_shuffle_epi8(table, _mm_and_si128(value, nibble_mask));
+    __m128i high = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(value, 4), nibble_mask));
+
+    // the dilated nibbles of a byte form its dilated 16 bits, two of those a coordinate
+    *low_half = _mm_unpacklo_epi8(low, high);
+    *high_half = _mm_unpackhi_epi8(low, high);
+}
+
+static inline __attribute__((always_inline)) void decode8_sse(__m128i idx0, __m128i idx1, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    const __m128i table_x = _mm_setr_epi8(NIBBLE_X);
+    const __m128i table_y = _mm_setr_epi8(NIBBLE_Y);
+
+    __m128i x_vec = _mm_packus_epi32(decode_lanes_sse(idx0, table_x), decode_lanes_sse(idx1, table_x));
+    __m128i y_vec = _mm_packus_epi32(decode_lanes_sse(idx0, table_y), decode_lanes_sse(idx1, table_y));
+
+    store_si128(x, x_vec, mode);
+    store_si128(y, y_vec, mode);
+}
+
+__attribute__((target("avx2"))) static inline __m256i decode_lanes_avx2(__m256i idx, __m256i table)
+{
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+
+    __m256i low = _mm256_and_si256(idx, nibble_mask);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(idx, 4), nibble_mask);
+
+    __m256i bytes = _mm256_or_si256(_mm256_shuffle_epi8(table, low), _mm256_slli_epi16(_mm256_shuffle_epi8(table, high), 2));
+
+    __m256i words = _mm256_maddubs_epi16(bytes, _mm256_set1_epi16(0x1001));
+    return _mm256_madd_epi16(words, _mm256_set1_epi32(0x01000001));
+}
+
+// the pack works per 128 bit half and leaves the 64 bit quarters in the order 0 2 1 3
+__attribute__((target("avx2"))) static inline void decode16_avx2(__m256i idx0, __m256i idx1, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    const __m256i table_x = _mm256_setr_epi8(NIBBLE_X, NIBBLE_X);
+    const __m256i table_y = _mm256_setr_epi8(NIBBLE_Y, NIBBLE_Y);
+
+    __m256i x_vec = _mm256_packus_epi32(decode_lanes_avx2(idx0, table_x), decode_lanes_avx2(idx1, table_x));
+    __m256i y_vec = _mm256_packus_epi32(decode_lanes_avx2(idx0, table_y), decode_lanes_avx2(idx1, table_y));
+    x_vec = _mm256_permute4x64_epi64(x_vec, _MM_SHUFFLE(3, 1, 2, 0));
+    y_vec = _mm256_permute4x64_epi64(y_vec, _MM_SHUFFLE(3, 1, 2, 0));
+
+    store_si128(x, _mm256_castsi256_si128(x_vec), mode);
+    store_si128(x + 8, _mm256_extracti128_si256(x_vec, 1), mode);
+    store_si128(y, _mm256_castsi256_si128(y_vec), mode);
+    store_si128(y + 8, _mm256_extracti128_si256(y_vec, 1), mode);
+}
+
+static inline __attribute__((always_inline)) void z_curve_shuffle_sse_kernel(size_t max, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    __m128i idx0 = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i idx1 = _mm_setr_epi32(4, 5, 6, 7);
+    const __m128i step = _mm_set1_epi32(8);
+
+    for (size_t i = 0; i < max; i += 8)
+    {
+        decode8_sse(idx0, idx1, &x[i], &y[i], mode);
+
+        idx0 = _mm_add_epi32(idx0, step);
+        idx1 = _mm_add_epi32(idx1, step);
+    }
+}
+
+__attribute__((target("avx2"))) static inline void z_curve_shuffle_avx2_kernel(size_t max, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    __m256i idx0 = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i idx1 = _mm256_setr_epi32(8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i step = _mm256_set1_epi32(16);
+
+    for (size_t i = 0; i < max; i += 16)
+    {
+        decode16_avx2(idx0, idx1, &x[i], &y[i], mode);
+
+        idx0 = _mm256_add_epi32(idx0, step);
+        idx1 = _mm256_add_epi32(idx1, step);
+    }
+}
+
+__attribute__((target("avx2"))) static void z_curve_shuffle_avx2(size_t max, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    STORE_MODE_DISPATCH(mode, z_curve_shuffle_avx2_kernel, max, x, y);
+}
+
+void z_curve_shuffle(unsigned degree, coord_t *x, coord_t *y)
+{
+    size_t max = 1ull << (degree * 2);
+
+    // the kernels need at least 8 points
+    if (max < 8)
+    {
+        size_t idx[4] = {0, 1, 2, 3};
+        z_curve_shuffle_batch_at(idx, max, x, y);
+        return;
+    }
+
+    store_mode_t mode = select_store_mode(degree, x, y);
+
+    if (max >= 16 && cpu_has_avx2())
+    {
+        z_curve_shuffle_avx2(max, x, y, mode);
+    }
+    else
+    {
+        STORE_MODE_DISPATCH(mode, z_curve_shuffle_sse_kernel, max, x, y);
+    }
+}
+
+// four indices narrowed to 32 bit lanes
+static inline __m128i load_indices_sse(const size_t *idx)
+{
+    __m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&idx[0]), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&idx[2]), _MM_SHUFFLE(3, 1, 2, 0));
+
+    return _mm_unpacklo_epi64(a, b);
+}
+
+// eight indices narrowed to 32 bit lanes
+__attribute__((target("avx2"))) static inline __m256i load_indices_avx2(const size_t *idx)
+{
+    const __m256i low_halves = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+    __m256i a = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&idx[0]), low_halves);
+    __m256i b = _mm256_permutevar8x32_epi32(_mm256_loadu_si256((const __m256i *)&idx[4]), low_halves);
+
+    return _mm256_permute2x128_si256(a, b, 0x20);
+}
+
+static size_t z_curve_shuffle_batch_at_sse(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        decode8_sse(load_indices_sse(&idx[i]), load_indices_sse(&idx[i + 4]), &x[i], &y[i], STORE_UNALIGNED);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx2"))) static size_t z_curve_shuffle_batch_at_avx2(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        decode16_avx2(load_indices_avx2(&idx[i]), load_indices_avx2(&idx[i + 8]), &x[i], &y[i], STORE_UNALIGNED);
+    }
+
+    return i;
+}
+
+void z_curve_shuffle_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    size_t done = cpu_has_avx2() ? z_curve_shuffle_batch_at_avx2(idx, count, x, y) : 0;
+
+    done += z_curve_shuffle_batch_at_sse(idx + done, count - done, x + done, y + done);
+
+    // there is no scalar table, pad the rest to a full vector instead
+    if (done < count)
+    {
+        size_t padded_idx[8] = {0};
+        coord_t padded_x[8], padded_y[8];
+
+        memcpy(padded_idx, idx + done, (count - done) * sizeof(size_t));
+        z_curve_shuffle_batch_at_sse(padded_idx, 8, padded_x, padded_y);
+        memcpy(x + done, padded_x, (count - done) * sizeof(coord_t));
+        memcpy(y + done, padded_y, (count - done) * sizeof(coord_t));
+    }
+}
+
+static inline void encode8_sse(const coord_t *x, const coord_t *y, size_t *idx)
+{
+    __m128i x_low, x_high, y_low, y_high;
+    dilate_lanes_sse(_mm_loadu_si128((const __m128i *)x), &x_low, &x_high);
+    dilate_lanes_sse(_mm_loadu_si128((const __m128i *)y), &y_low, &y_high);
+
+    __m128i idx_low = _mm_or_si128(x_low, _mm_slli_epi32(y_low, 1));
+    __m128i idx_high = _mm_or_si128(x_high, _mm_slli_epi32(y_high, 1));
+
+    _mm_storeu_si128((__m128i *)&idx[0], _mm_cvtepu32_epi64(idx_low));
+    _mm_storeu_si128((__m128i *)&idx[2], _mm_cvtepu32_epi64(_mm_srli_si128(idx_low, 8)));
+    _mm_storeu_si128((__m128i *)&idx[4], _mm_cvtepu32_epi64(idx_high));
+    _mm_storeu_si128((__m128i *)&idx[6], _mm_cvtepu32_epi64(_mm_srli_si128(idx_high, 8)));
+}
+
+/*
+sixteen points, the unpacks work per 128 bit half: the low unpack holds
+points 0-3 and 8-11, the high one points 4-7 and 12-15
+*/
+__attribute__((target("avx2"))) static inline void encode16_avx2(const coord_t *x, const coord_t *y, size_t *idx)
+{
+    const __m256i table = _mm256_setr_epi8(NIBBLE_DILATE, NIBBLE_DILATE);
+    const __m256i nibble_mask = _mm256_set1_epi8(0x0f);
+
+    __m256i x_vec = _mm256_loadu_si256((const __m256i *)x);
+    __m256i y_vec = _mm256_loadu_si256((const __m256i *)y);
+
+    __m256i x_low = _mm256_shuffle_epi8(table, _mm256_and_si256(x_vec, nibble_mask));
+    __m256i x_high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(x_vec, 4), nibble_mask));
+    __m256i y_low = _mm256_shuffle_epi8(table, _mm256_and_si256(y_vec, nibble_mask));
+    __m256i y_high = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(y_vec, 4), nibble_mask));
+
+    __m256i first = _mm256_or_si256(_mm256_unpacklo_epi8(x_low, x_high), _mm256_slli_epi32(_mm256_unpacklo_epi8(y_low, y_high), 1));
+    __m256i second = _mm256_or_si256(_mm256_unpackhi_epi8(x_low, x_high), _mm256_slli_epi32(_mm256_unpackhi_epi8(y_low, y_high), 1));
+
+    _mm256_storeu_si256((__m256i *)&idx[0], _mm256_cvtepu32_epi64(_mm256_castsi256_si128(first)));
+    _mm256_storeu_si256((__m256i *)&idx[4], _mm256_cvtepu32_epi64(_mm256_castsi256_si128(second)));
+    _mm256_storeu_si256((__m256i *)&idx[8], _mm256_cvtepu32_epi64(_mm256_extracti128_si256(first, 1)));
+    _mm256_storeu_si256((__m256i *)&idx[12], _mm256_cvtepu32_epi64(_mm256_extracti128_si256(second, 1)));
+}
+
+__attribute__((target("avx2"))) static size_t z_curve_shuffle_pos_batch_avx2(const coord_t *x, const coord_t *y, size_t count, size_t *idx)
+{
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16)
+    {
+        encode16_avx2(&x[i], &y[i], &idx[i]);
+    }
+
+    return i;
+}
+
+void z_curve_shuffle_pos_batch(const coord_t *x, const coord_t *y, size_t count, size_t *idx)
+{
+    size_t i = cpu_has_avx2() ? z_curve_shuffle_pos_batch_avx2(x, y, count, idx) : 0;
+
+    for (; i + 8 <= count; i += 8)
+    {
+        encode8_sse(&x[i], &y[i], &idx[i]);
+    }
+
+    if (i < count)
+    {
+        coord_t padded_x[8] = {0}, padded_y[8] = {0};
+        size_t padded_idx[8];
+
+        memcpy(padded_x, x + i, (count - i) * sizeof(coord_t));
+        memcpy(padded_y, y + i, (count - i) * sizeof(coord_t));
+        encode8_sse(padded_x, padded_y, padded_idx);
+        memcpy(idx + i, padded_idx, (count - i) * sizeof(size_t));
+    }
+}
+
+void z_curve_shuffle_at(unsigned degree, size_t idx, coord_t *x, coord_t *y)
+{
+    (void)degree;
+    z_curve_shuffle_batch_at(&idx, 1, x, y);
+}
+
+size_t z_curve_shuffle_pos(unsigned degree, coord_t x, coord_t y)
+{
+    (void)degree;
+
+    size_t idx;
+    z_curve_shuffle_pos_batch(&x, &y, 1, &idx);
+
+    return idx;
+}
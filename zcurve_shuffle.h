@@ -0,0 +1,19 @@
+#ifndef _ZCURVE_SHUFFLE_H
+#define _ZCURVE_SHUFFLE_H
+
+#include "defs.h"
+
+/*
+lookup tables of 16 entries held in a register and indexed with
+pshufb, every byte of an index is decoded nibble by nibble and every
+nibble of a coordinate is dilated the same way, without touching memory
+for the tables. Uses AVX2 when the CPU has it
+*/
+void z_curve_shuffle(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_shuffle_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
+size_t z_curve_shuffle_pos(unsigned degree, coord_t x, coord_t y);
+
+void z_curve_shuffle_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y);
+void z_curve_shuffle_pos_batch(const coord_t *x, const coord_t *y, size_t count, size_t *idx);
+
+#endif // _ZCURVE_SHUFFLE_H
@@ -1,19 +1,11 @@
 #include "zcurve_simd.h"
 #include "zcurve_lookup.h"
+#include "zcurve_magic.h"
 
 #include <stdio.h>
 
-void z_curve_simd(unsigned degree, coord_t *x, coord_t *y)
+static inline __attribute__((always_inline)) void z_curve_simd_kernel(unsigned degree, coord_t *x, coord_t *y, store_mode_t mode)
 {
-    if (degree == 1)
-    {
-        // base case
-        *(size_t *)x = 0x100000001ull;
-        *(size_t *)y = 0x10001ull;
-
-        return;
-    }
-
     // number of max points is 4^degree
     size_t max = (1ull << (degree * 2)) >> 3;
 
@@ -29,7 +21,47 @@ void z_curve_simd(unsigned degree, coord_t *x, coord_t *y)
             x_vec = _mm_or_si128(x_vec, _mm_slli_epi16(_mm_and_si128(_mm_set_epi16(1, 1, 1, 1, 1, 1, 1, 1), _mm_srli_epi16(_mm_set_epi16(idx + 7, idx + 6, idx + 5, idx + 4, idx + 3, idx + 2, idx + 1, idx), j << 1)), j));
             y_vec = _mm_or_si128(y_vec, _mm_slli_epi16(_mm_and_si128(_mm_set_epi16(1, 1, 1, 1, 1, 1, 1, 1), _mm_srli_epi16(_mm_set_epi16(idx + 7, idx + 6, idx + 5, idx + 4, idx + 3, idx + 2, idx + 1, idx), (j << 1) + 1)), j));
         }
-        _mm_storeu_si128((__m128i *)&x[idx], x_vec);
-        _mm_storeu_si128((__m128i *)&y[idx], y_vec);
+        store_si128(&x[idx], x_vec, mode);
+        store_si128(&y[idx], y_vec, mode);
+    }
+}
+
+static inline __attribute__((always_inline)) void z_curve_simd_store_modes(unsigned degree, coord_t *x, coord_t *y, store_mode_t mode)
+{
+    STORE_MODE_DISPATCH(mode, z_curve_simd_kernel, degree, x, y);
+}
+
+typedef void (*z_curve_simd_kernel_t)(coord_t *x, coord_t *y, store_mode_t mode);
+
+#define Z_CURVE_SIMD_KERNEL(d)                                                      \
+    static void z_curve_simd_kernel_d##d(coord_t *x, coord_t *y, store_mode_t mode) \
+    {                                                                               \
+        z_curve_simd_store_modes(d, x, y, mode);                                    \
+    }
+FOR_EACH_DEGREE(Z_CURVE_SIMD_KERNEL)
+#undef Z_CURVE_SIMD_KERNEL
+
+#define Z_CURVE_SIMD_KERNEL_ENTRY(d) z_curve_simd_kernel_d##d,
+static const z_curve_simd_kernel_t z_curve_simd_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_SIMD_KERNEL_ENTRY)};
+#undef Z_CURVE_SIMD_KERNEL_ENTRY
+
+void z_curve_simd(unsigned degree, coord_t *x, coord_t *y)
+{
+    // the kernels store whole vectors, the four points of degree 1 are decoded one by one
+    if (degree == 1)
+    {
+        z_curve_magic(degree, x, y);
+        return;
+    }
+
+    store_mode_t mode = select_store_mode(degree, x, y);
+
+    if (degree >= 1 && degree <= DEGREE_MAX)
+    {
+        z_curve_simd_kernels[degree - 1](x, y, mode);
+    }
+    else
+    {
+        z_curve_simd_store_modes(degree, x, y, mode);
     }
 }
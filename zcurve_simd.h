@@ -2,7 +2,82 @@
 #define _ZCURVE_SIMD_H
 
 #include "defs.h"
+#include "zcurve_memory.h"
 #include <immintrin.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum
+{
+    STORE_UNALIGNED,
+    STORE_ALIGNED,
+    STORE_STREAM
+} store_mode_t;
+
+/*
+pick the cheapest store for a curve of the given degree:
+aligned stores need both arrays on a 16 byte boundary, and once the
+output no longer fits into the last level cache it is never read back
+from there, so we bypass the cache with non-temporal stores and save
+the read-for-ownership traffic
+*/
+static inline store_mode_t select_store_mode(unsigned degree, const coord_t *x, const coord_t *y)
+{
+    if (((uintptr_t)x | (uintptr_t)y) & 0xf)
+    {
+        return STORE_UNALIGNED;
+    }
+
+    size_t bytes = (sizeof(coord_t) * 2) << (degree * 2);
+
+    return bytes > llc_size() ? STORE_STREAM : STORE_ALIGNED;
+}
+
+static inline __attribute__((always_inline)) void store_si128(coord_t *dst, __m128i value, store_mode_t mode)
+{
+    switch (mode)
+    {
+    case STORE_STREAM:
+        _mm_stream_si128((__m128i *)dst, value);
+        break;
+    case STORE_ALIGNED:
+        _mm_store_si128((__m128i *)dst, value);
+        break;
+    default:
+        _mm_storeu_si128((__m128i *)dst, value);
+        break;
+    }
+}
+
+/*
+calls kernel(args..., mode) with mode as a constant, so every store mode
+gets its own copy of an always_inline kernel and its loop stays branch
+free. Streaming stores are fenced before the dispatch returns, which on a
+worker thread is before its chunk counts as done
+*/
+#define STORE_MODE_DISPATCH(mode, kernel, ...)       \
+    do                                               \
+    {                                                \
+        switch (mode)                                \
+        {                                            \
+        case STORE_STREAM:                           \
+            kernel(__VA_ARGS__, STORE_STREAM);       \
+            _mm_sfence();                            \
+            break;                                   \
+        case STORE_ALIGNED:                          \
+            kernel(__VA_ARGS__, STORE_ALIGNED);      \
+            break;                                   \
+        default:                                     \
+            kernel(__VA_ARGS__, STORE_UNALIGNED);    \
+            break;                                   \
+        }                                            \
+    } while (0)
+
+// the build targets SSE4.2, AVX2 kernels are compiled per function and picked at runtime
+static inline bool cpu_has_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
 
 void z_curve_simd(unsigned degree, coord_t *x, coord_t *y);
 
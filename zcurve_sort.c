@@ -0,0 +1,218 @@
+#include <pthread.h>
+
+#include "zcurve_sort.h"
+
+typedef struct
+{
+    point32_t *points;
+    size_t count;
+    unsigned depth;
+    unsigned spawn;
+} sort_task_t;
+
+static inline void swap_points(point32_t *a, point32_t *b)
+{
+    point32_t tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+static void insertion_sort(point32_t *points, size_t count)
+{
+    for (size_t i = 1; i < count; ++i)
+    {
+        point32_t point = points[i];
+        size_t j = i;
+
+        for (; j > 0 && z_order_less(point, points[j - 1]); --j)
+        {
+            points[j] = points[j - 1];
+        }
+
+        points[j] = point;
+    }
+}
+
+static void sift_down(point32_t *points, size_t root, size_t count)
+{
+    for (size_t child = 2 * root + 1; child < count; child = 2 * root + 1)
+    {
+        if (child + 1 < count && z_order_less(points[child], points[child + 1]))
+        {
+            ++child;
+        }
+
+        if (!z_order_less(points[root], points[child]))
+        {
+            return;
+        }
+
+        swap_points(&points[root], &points[child]);
+        root = child;
+    }
+}
+
+static void heap_sort(point32_t *points, size_t count)
+{
+    for (size_t i = count / 2; i-- > 0;)
+    {
+        sift_down(points, i, count);
+    }
+
+    for (size_t end = count; end-- > 1;)
+    {
+        swap_points(&points[0], &points[end]);
+        sift_down(points, 0, end);
+    }
+}
+
+/*
+Hoare partition around the median of the first, middle and last point:
+returns m with [0, m) not after the pivot and [m, count) not before it,
+both sides non-empty
+*/
+static size_t partition(point32_t *points, size_t count)
+{
+    size_t mid = count / 2;
+
+    if (z_order_less(points[mid], points[0]))
+    {
+        swap_points(&points[mid], &points[0]);
+    }
+    if (z_order_less(points[count - 1], points[mid]))
+    {
+        swap_points(&points[count - 1], &points[mid]);
+
+        if (z_order_less(points[mid], points[0]))
+        {
+            swap_points(&points[mid], &points[0]);
+        }
+    }
+
+    point32_t pivot = points[mid];
+    size_t i = 0;
+    size_t j = count - 1;
+
+    for (;;)
+    {
+        while (z_order_less(points[i], pivot))
+        {
+            ++i;
+        }
+        while (z_order_less(pivot, points[j]))
+        {
+            --j;
+        }
+
+        if (i >= j)
+        {
+            return j + 1;
+        }
+
+        swap_points(&points[i++], &points[j--]);
+    }
+}
+
+// recurses into the smaller side and loops on the larger one, so the stack stays logarithmic
+static void introsort(point32_t *points, size_t count, unsigned depth)
+{
+    while (count > SORT_INSERTION_MAX)
+    {
+        if (depth == 0)
+        {
+            // too many bad pivots, heap sort keeps the worst case at n log n
+            heap_sort(points, count);
+            return;
+        }
+
+        --depth;
+
+        size_t m = partition(points, count);
+
+        if (m < count - m)
+        {
+            introsort(points, m, depth);
+            points += m;
+            count -= m;
+        }
+        else
+        {
+            introsort(&points[m], count - m, depth);
+            count = m;
+        }
+    }
+
+    insertion_sort(points, count);
+}
+
+static unsigned depth_limit(size_t count)
+{
+    unsigned depth = 0;
+
+    for (; count > 1; count >>= 1)
+    {
+        depth += 2;
+    }
+
+    return depth;
+}
+
+void z_curve_sort(point32_t *points, size_t count)
+{
+    introsort(points, count, depth_limit(count));
+}
+
+static void *sort_thread(void *arg);
+
+/*
+the first spawn levels of partitions hand their lower side to a new
+thread and keep the upper side, every thread then sorts its range with
+the sequential introsort. If a thread cannot be started its side is
+sorted inline
+*/
+static void parallel_introsort(point32_t *points, size_t count, unsigned depth, unsigned spawn)
+{
+    if (spawn == 0 || depth == 0 || count < SORT_PARALLEL_MIN)
+    {
+        introsort(points, count, depth);
+        return;
+    }
+
+    size_t m = partition(points, count);
+
+    sort_task_t lower = {.points = points, .count = m, .depth = depth - 1, .spawn = spawn - 1};
+    pthread_t thread;
+    bool started = pthread_create(&thread, NULL, sort_thread, &lower) == 0;
+
+    if (!started)
+    {
+        parallel_introsort(points, m, depth - 1, spawn - 1);
+    }
+
+    parallel_introsort(&points[m], count - m, depth - 1, spawn - 1);
+
+    if (started)
+    {
+        pthread_join(thread, NULL);
+    }
+}
+
+static void *sort_thread(void *arg)
+{
+    sort_task_t *task = (sort_task_t *)arg;
+    parallel_introsort(task->points, task->count, task->depth, task->spawn);
+
+    return NULL;
+}
+
+void z_curve_sort_parallel(point32_t *points, size_t count, unsigned num_threads)
+{
+    // twice as many ranges as threads, so one bad pivot does not leave a thread idle for long
+    unsigned spawn = 1;
+    for (unsigned leaves = 2; leaves < num_threads * 2; leaves <<= 1)
+    {
+        ++spawn;
+    }
+
+    parallel_introsort(points, count, depth_limit(count), num_threads > 1 ? spawn : 0);
+}
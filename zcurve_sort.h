@@ -0,0 +1,53 @@
+#ifndef _ZCURVE_SORT_H
+#define _ZCURVE_SORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "defs.h"
+
+// ranges below this are finished with an insertion sort
+#define SORT_INSERTION_MAX 16
+
+// ranges below this are never split between threads
+#define SORT_PARALLEL_MIN (1u << 14)
+
+// points with full 32 bit coordinates, their Z order keys would need 64 bits
+typedef struct
+{
+    uint32_t x;
+    uint32_t y;
+} point32_t;
+
+// true if the highest set bit of a is below the highest set bit of b
+static inline bool z_order_less_msb(uint32_t a, uint32_t b)
+{
+    return a < b && a < (a ^ b);
+}
+
+/*
+Z order without keys: the order of two points is decided by their most
+significant differing bit, and that bit belongs to whichever coordinate
+has the higher bit in its XOR. y takes the odd bit of every pair, so on
+a tie in the highest bit it wins and x only decides when its difference
+reaches strictly higher
+*/
+static inline bool z_order_less(point32_t a, point32_t b)
+{
+    uint32_t dx = a.x ^ b.x;
+    uint32_t dy = a.y ^ b.y;
+
+    return z_order_less_msb(dy, dx) ? a.x < b.x : a.y < b.y;
+}
+
+// qsort style -1, 0 or 1
+static inline int z_order_compare(point32_t a, point32_t b)
+{
+    return z_order_less(a, b) ? -1 : z_order_less(b, a);
+}
+
+// in-place introsort into Z order, the parallel one splits the first partitions between threads
+void z_curve_sort(point32_t *points, size_t count);
+void z_curve_sort_parallel(point32_t *points, size_t count, unsigned num_threads);
+
+#endif // _ZCURVE_SORT_H
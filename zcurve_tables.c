@@ -0,0 +1,175 @@
+#include <pthread.h>
+
+#include "zcurve_tables.h"
+#include "zcurve_codec.h"
+#include "zcurve_memory.h"
+
+#define RUNTIME_HALF_BITS (RUNTIME_TABLE_BITS / 2)
+#define RUNTIME_HALF_MASK ((1u << RUNTIME_HALF_BITS) - 1)
+
+static runtime_entry_t *runtime_table = NULL;
+static pthread_once_t runtime_table_once = PTHREAD_ONCE_INIT;
+
+// the table lives as long as the process, it is never freed
+static void build_runtime_table(void)
+{
+    runtime_entry_t *table = (runtime_entry_t *)z_curve_alloc(z_curve_runtime_table_size());
+    if (table == NULL)
+    {
+        return;
+    }
+
+    for (unsigned i = 0; i < RUNTIME_TABLE_ENTRIES; ++i)
+    {
+        coord_t x, y;
+        decode(i, &x, &y);
+
+        table[i] = (runtime_entry_t)(x | (y << RUNTIME_HALF_BITS));
+    }
+
+    runtime_table = table;
+}
+
+const runtime_entry_t *z_curve_runtime_table(void)
+{
+    pthread_once(&runtime_table_once, build_runtime_table);
+
+    return runtime_table;
+}
+
+size_t z_curve_runtime_table_size(void)
+{
+    return sizeof(runtime_entry_t) * RUNTIME_TABLE_ENTRIES;
+}
+
+static inline void lookup_runtime(const runtime_entry_t *table, unsigned iterations, size_t idx, coord_t *x, coord_t *y)
+{
+    unsigned x_value = 0, y_value = 0;
+
+    for (unsigned i = 0; i < iterations && idx > 0; ++i)
+    {
+        runtime_entry_t entry = table[idx & (RUNTIME_TABLE_ENTRIES - 1)];
+
+        // both halves of the entry hold RUNTIME_HALF_BITS coordinate bits
+        x_value |= (unsigned)(entry & RUNTIME_HALF_MASK) << (i * RUNTIME_HALF_BITS);
+        y_value |= (unsigned)(entry >> RUNTIME_HALF_BITS) << (i * RUNTIME_HALF_BITS);
+
+        idx >>= RUNTIME_TABLE_BITS;
+    }
+
+    *x = (coord_t)x_value;
+    *y = (coord_t)y_value;
+}
+
+// lookups needed for the index bits of a degree
+static inline unsigned runtime_iterations(unsigned degree)
+{
+    return (degree * 2 + RUNTIME_TABLE_BITS - 1) / RUNTIME_TABLE_BITS;
+}
+
+/*
+curve kernel for the runtime table, instantiated per degree like the
+static table kernels: the lookups unroll fully and also run for the zero
+chunks, the table maps 0 to (0, 0)
+*/
+static inline __attribute__((always_inline)) void z_curve_lookup_runtime_kernel(const runtime_entry_t *table, unsigned degree, coord_t *x, coord_t *y)
+{
+    // number of max points is 4^degree
+    size_t max = 1ull << (degree * 2);
+    unsigned iterations = runtime_iterations(degree);
+
+    for (size_t i = 0; i < max; ++i)
+    {
+        size_t idx = i;
+        unsigned x_value = 0, y_value = 0;
+
+        for (unsigned j = 0; j < iterations; ++j)
+        {
+            runtime_entry_t entry = table[idx & (RUNTIME_TABLE_ENTRIES - 1)];
+
+            x_value |= (unsigned)(entry & RUNTIME_HALF_MASK) << (j * RUNTIME_HALF_BITS);
+            y_value |= (unsigned)(entry >> RUNTIME_HALF_BITS) << (j * RUNTIME_HALF_BITS);
+
+            idx >>= RUNTIME_TABLE_BITS;
+        }
+
+        x[i] = (coord_t)x_value;
+        y[i] = (coord_t)y_value;
+    }
+}
+
+typedef void (*z_curve_lookup_runtime_kernel_t)(const runtime_entry_t *table, coord_t *x, coord_t *y);
+
+#define Z_CURVE_LOOKUP_RUNTIME_KERNEL(d)                                                      \
+    static void z_curve_lookup_runtime_d##d(const runtime_entry_t *table, coord_t *x, coord_t *y) \
+    {                                                                                         \
+        z_curve_lookup_runtime_kernel(table, d, x, y);                                        \
+    }
+FOR_EACH_DEGREE(Z_CURVE_LOOKUP_RUNTIME_KERNEL)
+#undef Z_CURVE_LOOKUP_RUNTIME_KERNEL
+
+#define Z_CURVE_LOOKUP_RUNTIME_ENTRY(d) z_curve_lookup_runtime_d##d,
+static const z_curve_lookup_runtime_kernel_t z_curve_lookup_runtime_kernels[DEGREE_MAX] = {FOR_EACH_DEGREE(Z_CURVE_LOOKUP_RUNTIME_ENTRY)};
+#undef Z_CURVE_LOOKUP_RUNTIME_ENTRY
+
+void z_curve_lookup_runtime(unsigned degree, coord_t *x, coord_t *y)
+{
+    // number of max points is 4^degree
+    size_t max = 1ull << (degree * 2);
+
+    const runtime_entry_t *table = z_curve_runtime_table();
+    if (table == NULL)
+    {
+        for (size_t i = 0; i < max; ++i)
+        {
+            decode(i, &x[i], &y[i]);
+        }
+        return;
+    }
+
+    if (degree >= 1 && degree <= DEGREE_MAX)
+    {
+        z_curve_lookup_runtime_kernels[degree - 1](table, x, y);
+    }
+    else
+    {
+        z_curve_lookup_runtime_kernel(table, degree, x, y);
+    }
+}
+
+void z_curve_lookup_runtime_at(unsigned degree, size_t idx, coord_t *x, coord_t *y)
+{
+    if (degree > DEGREE_MAX)
+    {
+        degree = DEGREE_MAX;
+    }
+
+    const runtime_entry_t *table = z_curve_runtime_table();
+    if (table == NULL)
+    {
+        decode(idx, x, y);
+        return;
+    }
+
+    lookup_runtime(table, runtime_iterations(degree), idx, x, y);
+}
+
+void z_curve_lookup_runtime_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y)
+{
+    const runtime_entry_t *table = z_curve_runtime_table();
+    if (table == NULL)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            decode(idx[i], &x[i], &y[i]);
+        }
+        return;
+    }
+
+    unsigned iterations = runtime_iterations(DEGREE_MAX);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        lookup_runtime(table, iterations, idx[i], &x[i], &y[i]);
+    }
+}
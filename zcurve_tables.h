@@ -0,0 +1,37 @@
+#ifndef _ZCURVE_TABLES_H
+#define _ZCURVE_TABLES_H
+
+#include "defs.h"
+
+// index bits decoded per lookup, picked at build time with make RUNTIME_TABLE_BITS=4|8|16
+#ifndef RUNTIME_TABLE_BITS
+#define RUNTIME_TABLE_BITS 8
+#endif
+
+#if RUNTIME_TABLE_BITS != 4 && RUNTIME_TABLE_BITS != 8 && RUNTIME_TABLE_BITS != 16
+#error "RUNTIME_TABLE_BITS must be 4, 8 or 16"
+#endif
+
+#define RUNTIME_TABLE_ENTRIES (1u << RUNTIME_TABLE_BITS)
+
+/*
+lookup table built on first use instead of compiled in. Each entry holds
+the x bits in its low and the y bits in its high half, which is one byte
+for the 4 and 8 bit tables and two for the 16 bit table instead of the
+four of a lookup_t
+*/
+#if RUNTIME_TABLE_BITS == 16
+typedef unsigned short runtime_entry_t;
+#else
+typedef unsigned char runtime_entry_t;
+#endif
+
+// NULL if the table could not be allocated
+const runtime_entry_t *z_curve_runtime_table(void);
+size_t z_curve_runtime_table_size(void);
+
+void z_curve_lookup_runtime(unsigned degree, coord_t *x, coord_t *y);
+void z_curve_lookup_runtime_at(unsigned degree, size_t idx, coord_t *x, coord_t *y);
+void z_curve_lookup_runtime_batch_at(const size_t *idx, size_t count, coord_t *x, coord_t *y);
+
+#endif // _ZCURVE_TABLES_H
@@ -0,0 +1,168 @@
+#include <string.h>
+
+#include "zcurve_view.h"
+#include "zcurve_magic.h"
+#include "zcurve_memory.h"
+
+static inline size_t view_cache_size(void)
+{
+    return sizeof(coord_t) * VIEW_CHUNK_POINTS * VIEW_CACHE_CHUNKS * 2;
+}
+
+static inline coord_t *slot_x(const z_curve_view_t *view, unsigned slot)
+{
+    return &view->cache[slot * VIEW_CHUNK_POINTS];
+}
+
+static inline coord_t *slot_y(const z_curve_view_t *view, unsigned slot)
+{
+    return &view->cache[(VIEW_CACHE_CHUNKS + slot) * VIEW_CHUNK_POINTS];
+}
+
+int z_curve_view_init(z_curve_view_t *view, unsigned degree)
+{
+    if (degree > DEGREE_MAX)
+    {
+        return -1;
+    }
+
+    view->cache = (coord_t *)z_curve_alloc(view_cache_size());
+    if (view->cache == NULL)
+    {
+        return -1;
+    }
+
+    view->degree = degree;
+    view->num_points = 1ull << (degree * 2);
+    view->last_slot = 0;
+    view->clock = 0;
+    view->hits = 0;
+    view->misses = 0;
+
+    for (unsigned i = 0; i < VIEW_CACHE_CHUNKS; ++i)
+    {
+        view->chunk[i] = VIEW_CHUNK_NONE;
+        view->last_used[i] = 0;
+    }
+
+    return 0;
+}
+
+void z_curve_view_destroy(z_curve_view_t *view)
+{
+    z_curve_free(view->cache, view_cache_size());
+    view->cache = NULL;
+}
+
+size_t z_curve_view_size(const z_curve_view_t *view)
+{
+    return sizeof(*view) + view_cache_size();
+}
+
+// a miss is decoded into the least recently used slot
+unsigned z_curve_view_fetch(z_curve_view_t *view, size_t chunk)
+{
+    unsigned slot, victim = 0;
+
+    for (slot = 0; slot < VIEW_CACHE_CHUNKS && view->chunk[slot] != chunk; ++slot)
+    {
+        if (view->last_used[slot] < view->last_used[victim])
+        {
+            victim = slot;
+        }
+    }
+
+    if (slot == VIEW_CACHE_CHUNKS)
+    {
+        size_t start = chunk * VIEW_CHUNK_POINTS;
+        size_t count = view->num_points - start < VIEW_CHUNK_POINTS ? view->num_points - start : VIEW_CHUNK_POINTS;
+
+        z_curve_simd_magic_range(view->degree, start, count, slot_x(view, victim), slot_y(view, victim));
+
+        view->chunk[victim] = chunk;
+        view->misses++;
+        slot = victim;
+    }
+    else
+    {
+        view->hits++;
+    }
+
+    // the last slot is always the most recent one, it only needs a stamp when it changes
+    view->last_used[slot] = ++view->clock;
+    view->last_slot = slot;
+
+    return slot;
+}
+
+static inline unsigned view_fetch(z_curve_view_t *view, size_t chunk)
+{
+    if (view->chunk[view->last_slot] == chunk)
+    {
+        view->hits++;
+        return view->last_slot;
+    }
+
+    return z_curve_view_fetch(view, chunk);
+}
+
+size_t z_curve_view_chunk(z_curve_view_t *view, size_t idx, const coord_t **x, const coord_t **y)
+{
+    if (idx >= view->num_points)
+    {
+        return 0;
+    }
+
+    unsigned slot = view_fetch(view, idx / VIEW_CHUNK_POINTS);
+    size_t offset = idx % VIEW_CHUNK_POINTS;
+    size_t end = idx - offset + VIEW_CHUNK_POINTS;
+
+    *x = slot_x(view, slot) + offset;
+    *y = slot_y(view, slot) + offset;
+
+    return (end < view->num_points ? end : view->num_points) - idx;
+}
+
+size_t z_curve_view_span(z_curve_view_t *view, size_t start, size_t count, coord_t *x, coord_t *y)
+{
+    if (start >= view->num_points)
+    {
+        return 0;
+    }
+
+    if (count > view->num_points - start)
+    {
+        count = view->num_points - start;
+    }
+
+    size_t done = 0;
+
+    while (done < count)
+    {
+        size_t idx = start + done;
+        size_t remaining = count - done;
+
+        // whole chunks are cheaper to decode again than to cache
+        if (idx % VIEW_CHUNK_POINTS == 0 && remaining >= VIEW_CHUNK_POINTS)
+        {
+            size_t bulk = remaining - remaining % VIEW_CHUNK_POINTS;
+
+            z_curve_simd_magic_range(view->degree, idx, bulk, x + done, y + done);
+            done += bulk;
+            continue;
+        }
+
+        const coord_t *chunk_x = NULL, *chunk_y = NULL;
+        size_t length = z_curve_view_chunk(view, idx, &chunk_x, &chunk_y);
+        if (length > remaining)
+        {
+            length = remaining;
+        }
+
+        memcpy(x + done, chunk_x, sizeof(coord_t) * length);
+        memcpy(y + done, chunk_y, sizeof(coord_t) * length);
+        done += length;
+    }
+
+    return count;
+}
@@ -0,0 +1,79 @@
+#ifndef _ZCURVE_VIEW_H
+#define _ZCURVE_VIEW_H
+
+#include <stdint.h>
+
+#include "defs.h"
+
+// points per cached chunk and chunks kept, 32 KiB of coordinates in total
+#define VIEW_CHUNK_POINTS 1024
+#define VIEW_CACHE_CHUNKS 8
+
+#define VIEW_CHUNK_NONE SIZE_MAX
+
+/*
+indexable curve that is never materialised: points are decoded on demand
+a chunk at a time with the SIMD kernel into a small LRU cache. Spans of
+whole chunks skip the cache and are decoded straight into the output
+*/
+typedef struct
+{
+    unsigned degree;
+    size_t num_points;
+
+    // slot of the last access, checked first so sequential access skips the search
+    unsigned last_slot;
+    uint64_t clock;
+    size_t chunk[VIEW_CACHE_CHUNKS];
+    uint64_t last_used[VIEW_CACHE_CHUNKS];
+
+    // VIEW_CACHE_CHUNKS x and then as many y chunks
+    coord_t *cache;
+
+    size_t hits;
+    size_t misses;
+} z_curve_view_t;
+
+int z_curve_view_init(z_curve_view_t *view, unsigned degree);
+void z_curve_view_destroy(z_curve_view_t *view);
+
+size_t z_curve_view_size(const z_curve_view_t *view);
+
+// slot of a chunk that is not the last one used, decoded on a miss
+unsigned z_curve_view_fetch(z_curve_view_t *view, size_t chunk);
+
+// -1 if idx is not on the curve. Inline, so sequential reads stay a compare and two loads
+static inline int z_curve_view_at(z_curve_view_t *view, size_t idx, coord_t *x, coord_t *y)
+{
+    if (idx >= view->num_points)
+    {
+        return -1;
+    }
+
+    size_t chunk = idx / VIEW_CHUNK_POINTS;
+    unsigned slot = view->last_slot;
+
+    if (view->chunk[slot] == chunk)
+    {
+        view->hits++;
+    }
+    else
+    {
+        slot = z_curve_view_fetch(view, chunk);
+    }
+
+    size_t offset = idx % VIEW_CHUNK_POINTS;
+
+    *x = view->cache[slot * VIEW_CHUNK_POINTS + offset];
+    *y = view->cache[(VIEW_CACHE_CHUNKS + slot) * VIEW_CHUNK_POINTS + offset];
+
+    return 0;
+}
+
+// copies up to count points from start on, returns the number copied
+size_t z_curve_view_span(z_curve_view_t *view, size_t start, size_t count, coord_t *x, coord_t *y);
+
+// the cached chunk holding idx from idx on, valid until the next access; returns its length or 0
+size_t z_curve_view_chunk(z_curve_view_t *view, size_t idx, const coord_t **x, const coord_t **y);
+
+#endif // _ZCURVE_VIEW_H